@@ -1,11 +1,16 @@
 #include "corrupt.h"
 
-Corruption::Corruption()
+#include "formats.h"
+#include "output.h"
+
+//  Plain data, for files that no other format matched or with --normal
+static formats::Registrar format({ "Data", "--normal", { ".iso" }, {}, formats::handler<Corruption>() });
+
+Corruption::Corruption() : protection(std::make_shared<engine::ProtectionMap>())
 {
-  this->random.seed(this->rd());
 }
 
-Corruption::Corruption(std::string filename, std::vector<std::string>& args)
+Corruption::Corruption(std::string filename, std::vector<std::string>& args) : protection(std::make_shared<engine::ProtectionMap>())
 {
   this->initialize(filename, args);
 }
@@ -16,13 +21,17 @@ Corruption::~Corruption()
 
 void Corruption::initialize(std::string filename, std::vector<std::string>& args)
 {
-  rom = util::read_file(filename);
-  this->info = std::make_unique<CorruptionInfo>(args);
-
-  if (info->save_file() == "")
+  if (!boost::filesystem::exists(filename))
   {
-    this->info->set_save_file(boost::filesystem::basename(filename));
+    throw InvalidFileNameException("Could not open file: " + filename);
   }
+
+  //  Corruptions go through the file in order
+  this->image = std::make_unique<util::MappedFile>(filename, true, util::Access::Sequential);
+  this->info = std::make_unique<CorruptionInfo>(args);
+  this->keep_original(info->patch());
+
+  this->name = boost::filesystem::basename(filename);
 }
 
 /*
@@ -36,13 +45,11 @@ void Corruption::save(std::string filename)
   {
     if (info->save_file() != "")
     {
-      util::write_file(info->save_file(), rom);
-      this->save_name = info->save_file();
+      this->save_name = this->write_rom(info->save_file(), info->patch());
     }
     else
     {
-      util::write_file(filename, rom);
-      this->save_name = filename;
+      this->save_name = this->write_rom(filename, info->patch());
     }
   }
   catch (InvalidFileNameException e)
@@ -52,128 +59,178 @@ void Corruption::save(std::string filename)
   }
 }
 
-void Corruption::corrupt()
+/*
+  Makes a new corruption of the loaded rom with its own arguments. The rom
+  is copied from this one, which should not have been corrupted yet, and
+  everything that was parsed or analyzed is shared.
+
+  @param args - Arguments of the new corruption
+
+  @return the new corruption.
+*/
+std::unique_ptr<Corruption> Corruption::variant(std::vector<std::string>& args)
 {
-  uint64_t corruptions = 0;
+  auto copy = std::make_unique<Corruption>();
+
+  copy->share(*this);
+  copy->info = std::make_unique<CorruptionInfo>(args);
+  copy->keep_original(copy->info->patch());
 
-  std::uniform_int_distribution<int> dist(0x00, 0xFF);
+  return copy;
+}
+
+/*
+  @return the name to save under when no output file is given, the base
+  name of the loaded file for formats that keep it and "output" otherwise.
+*/
+std::string Corruption::default_name()
+{
+  return this->name.empty() ? "output" : this->name;
+}
+
+/*
+  Shares the loaded rom and its analysis with another corruption, for
+  making variants.
+
+  @param other - The corruption to share with
+*/
+void Corruption::share(const Corruption& other)
+{
+  this->rom = other.rom;
+  this->protection = other.protection;
+  this->name = other.name;
 
-  for (uint32_t i = info->start();            // Start at header + start value
-    i < this->rom.size() && i < info->end();  // While in a valid range
-    i += info->step())                        // Increase by step size
+  //  Mapping the file again gives an untouched copy-on-write copy of it
+  if (other.image)
   {
-    if (info->type() == CorruptionType::Shift)
-    {
-      //  If it's okay to put the other byte in this position then change it
-      if (i + info->value() < rom.size() && valid_byte(this->rom[i + info->value()], i))
-      {
-        corruptions++;
-        this->rom[i] = this->rom[i + info->value()];
-      }
-    }
-    else if (info->type() == CorruptionType::Swap)
-    {
+    this->image = std::make_unique<util::MappedFile>(other.image->filename(), true, util::Access::Sequential);
+  }
+}
 
-      if (i + info->value() < rom.size() &&
-        valid_byte(this->rom[i + info->value()], i) &&  //  If it's okay to put the other byte in this position
-        valid_byte(this->rom[i], i))    //  And it's okay to put this byte in the other position
-      {
-        corruptions++;
-        uint8_t temp = this->rom[i + info->value()];
-        this->rom[i] = temp;
-        this->rom[i + info->value()] = temp;
-      }
-    }
-    else if (info->type() == CorruptionType::Add)
-    {
-      //  If the new byte value is valid then do the corruption
-      if (valid_byte(this->rom[i] + info->value(), i))
-      {
-        corruptions++;
-        this->rom[i] += info->value();
-      }
-    }
-    else if (info->type() == CorruptionType::Set)
-    {
-      //  If the set value can be placed here then do it
-      if (valid_byte(info->value(), i))
-      {
-        corruptions++;
-        this->rom[i] = info->value();
-      }
-    }
-    else if (info->type() == CorruptionType::Random)
-    {
-      bool corrupted = false;
-
-      //  Try up to 100 times to corrupt
-      for (uint32_t retry = 0; !corrupted && retry < 100; retry++)
-      {
-        uint8_t rand = dist(this->random);
-        if (valid_byte(rand, i))
-        {
-          corruptions++;
-          this->rom[i] = rand;
-          corrupted = true;
-        }
-      }
-    }
-    else if (info->type() == CorruptionType::RotateLeft)
-    {
-      uint8_t rotate = util::rol<uint8_t>(this->rom[i], info->value());
+/*
+  Keeps a copy of the loaded rom when a patch will be saved, since the
+  patch is made against it. Call once the rom is loaded and converted.
 
-      if (valid_byte(rotate, i))
-      {
-        this->rom[i] = rotate;
-        corruptions++;
-      }
-    }
-    else if (info->type() == CorruptionType::RotateRight)
-    {
-      uint8_t rotate = util::ror<uint8_t>(this->rom[i], info->value());
+  @param format - Format of the patch that will be saved
+*/
+void Corruption::keep_original(patch::Format format)
+{
+  if (format != patch::Format::None)
+  {
+    this->original = this->rom;
+  }
+}
 
-      if (valid_byte(rotate, i))
-      {
-        this->rom[i] = rotate;
-        corruptions++;
-      }
-    }
-    else if (info->type() == CorruptionType::LogicalAnd)
-    {
-      if (valid_byte(this->rom[i] & info->value(), i))
-      {
-        this->rom[i] &= info->value();
-        corruptions++;
-      }
-    }
-    else if (info->type() == CorruptionType::LogicalOr)
-    {
-      if (valid_byte(this->rom[i] | info->value(), i))
-      {
-        this->rom[i] |= info->value();
-        corruptions++;
-      }
-    }
-    else if (info->type() == CorruptionType::LogicalXor)
-    {
-      if (valid_byte(this->rom[i] ^ info->value(), i))
-      {
-        this->rom[i] ^= info->value();
-        corruptions++;
-      }
-    }
-    else if (info->type() == CorruptionType::LogicalComplement)
-    {
-      if (valid_byte(~this->rom[i], i))
-      {
-        this->rom[i] = ~this->rom[i];
-        corruptions++;
-      }
-    }
-    else
+/*
+  Writes the rom into a file, or a patch of the changes made to it when
+  --patch was given. Patches replace the extension of the filename.
+
+  @param filename - The file to write to.
+  @param format - Format of the patch, None writes the rom
+
+  @return the name of the file that was written.
+*/
+std::string Corruption::write_rom(std::string filename, patch::Format format)
+{
+  if (this->image)
+  {
+    return this->write_mapped(filename, format);
+  }
+
+  if (format == patch::Format::None)
+  {
+    util::write_file(filename, rom);
+    return filename;
+  }
+
+  filename = boost::filesystem::change_extension(filename, patch::extension(format)).string();
+
+  this->edits.diff(0, this->original, this->rom);
+  patch::write(filename, format, this->edits, this->original);
+  this->edits.clear();
+
+  return filename;
+}
+
+/*
+  Writes the mapped image into a file, or a patch against the file it was
+  mapped from. The file itself was never changed, so the output is a clone
+  of it with the dirty range written over it, and a patch maps it again to
+  find the changes instead of keeping a copy.
+
+  @param filename - The file to write to.
+  @param format - Format of the patch, None writes the image
+
+  @return the name of the file that was written.
+*/
+std::string Corruption::write_mapped(std::string filename, patch::Format format)
+{
+  if (format == patch::Format::None)
+  {
+    //  Only the range the corruption could have changed differs from the file
+    output::clone(this->image->filename(), filename);
+
+    if (this->dirty.end > this->dirty.begin)
     {
-      break;  //  No corruption selected, might as well quit.
+      output::File(filename).write(this->dirty.begin, this->image->data() + this->dirty.begin, this->dirty.end - this->dirty.begin);
     }
+
+    return filename;
+  }
+
+  filename = boost::filesystem::change_extension(filename, patch::extension(format)).string();
+
+  util::MappedFile source(this->image->filename(), false, util::Access::Sequential);
+
+  this->edits.diff(0, source.data(), this->image->data(), std::min(source.size(), this->image->size()));
+  patch::write(filename, format, this->edits, this->image->filename());
+  this->edits.clear();
+
+  return filename;
+}
+
+/*
+  Writes an image that was corrupted through edits instead of in memory,
+  as a clone of the source with the edits written over it or as a patch.
+
+  @param filename - The file to write to.
+  @param source - The original image
+  @param format - Format of the patch, None writes the image
+
+  @return the name of the file that was written.
+*/
+std::string Corruption::write_image(std::string filename, const std::string& source, patch::Format format)
+{
+  if (format == patch::Format::None)
+  {
+    output::clone(source, filename);
+    patch::apply(filename, this->edits);
+  }
+  else
+  {
+    filename = boost::filesystem::change_extension(filename, patch::extension(format)).string();
+    patch::write(filename, format, this->edits, source);
+  }
+
+  this->edits.clear();
+
+  return filename;
+}
+
+void Corruption::corrupt()
+{
+  uint64_t corruptions = 0;
+
+  if (this->image)
+  {
+    engine::Options options(*info);
+
+    corruptions = engine::corrupt(this->image->data(), this->image->size(), options, engine::Unprotected(), info->seed());
+    this->dirty = engine::dirty(this->image->size(), options);
+  }
+  else
+  {
+    corruptions = engine::corrupt(this->rom, engine::Options(*info), engine::Unprotected(), info->seed());
   }
 
   std::cout << "Replaced a total of " << corruptions << " bytes." << std::endl;
@@ -194,9 +251,9 @@ void Corruption::print_header()
   //debug::cout << "No header." << std::endl;
 }
 
-int Corruption::size()
+uint64_t Corruption::size()
 {
-  return rom.size();
+  return this->image ? this->image->size() : rom.size();
 }
 
 void Corruption::run()
@@ -8,9 +8,12 @@ CorruptionInfo::CorruptionInfo()
 
   m_step = 0;
   m_start = 0;
-  m_end = std::numeric_limits<uint32_t>::max();
+  m_end = std::numeric_limits<uint64_t>::max();
   m_value = 0;
 
+  m_seed = rng::next_seed();
+  m_patch = patch::Format::None;
+
   m_list = false;
 }
 
@@ -22,9 +25,12 @@ CorruptionInfo::CorruptionInfo(std::vector<std::string>& args)
 
   m_step = 0;
   m_start = 0;
-  m_end = std::numeric_limits<uint32_t>::max();
+  m_end = std::numeric_limits<uint64_t>::max();
   m_value = 0;
 
+  m_seed = rng::next_seed();
+  m_patch = patch::Format::None;
+
   m_list = false;
 
   for (uint32_t i = 0; i < args.size(); i++)
@@ -90,11 +96,19 @@ CorruptionInfo::CorruptionInfo(std::vector<std::string>& args)
     }
     else if (arg == "-b" || arg == "--start")
     {
-      m_start = util::to_int32(args[++i]);
+      m_start = util::to_int64(args[++i]);
     }
     else if (arg == "-e" || arg == "--stop")
     {
-      m_end = util::to_int32(args[++i]);
+      m_end = util::to_int64(args[++i]);
+    }
+    else if (arg == "--seed")
+    {
+      m_seed = util::to_int64(args[++i]);
+    }
+    else if (arg == "--patch")
+    {
+      m_patch = patch::format(args[++i]);
     }
     else if (arg == "-o" || arg == "--out")
     {
@@ -21,12 +21,12 @@ public:
   virtual void print_header();
   virtual void save(std::string filename);
 
+  virtual std::unique_ptr<Corruption> variant(std::vector<std::string>& args);
+
 private:
-  std::unique_ptr<IMG> rom;
+  std::shared_ptr<IMG> rom;
 
   std::string m_original_file;  //  Original filename
-  std::string m_temp_file;      //  Temp file name
-  bool m_saved;
 };
 
 #endif
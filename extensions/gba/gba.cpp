@@ -1,5 +1,10 @@
 #include "gba.h"
 
+#include "formats.h"
+
+//  Start of the Nintendo logo in the header
+static formats::Registrar format({ "GBA", "", { ".gba" }, { { 0x04, 0x24FFAE51 } }, formats::handler<GBACorruption>() });
+
 GBACorruption::GBACorruption()
 {
 
@@ -18,8 +23,9 @@ GBACorruption::~GBACorruption()
 void GBACorruption::initialize(std::string filename, std::vector<std::string>& args)
 {
   rom = util::read_file(filename);
-  header = std::make_unique<GBAHeader>(rom);
+  header = std::make_shared<GBAHeader>(rom);
   info = std::make_unique<CorruptionInfo>(args);
+  this->keep_original(info->patch());
 
   if (!valid())
   {
@@ -32,65 +38,35 @@ bool GBACorruption::valid()
   return header->valid();
 }
 
+void GBACorruption::corrupt()
+{
+  corrupt_rom(GBAValidator(rom));
+}
+
 bool GBACorruption::valid_byte(uint8_t byte, uint32_t location)
+{
+  return GBAValidator(rom).valid_byte(byte, location);
+}
+
+bool GBAValidator::protected_location(uint32_t location) const
 {
   //  If location is in the header then do nothing
   if (location < GBAHeader::Size)
   {
-    return false;
-  }
-
-  //  Entire instruction is at location of the nearest 4 byte boundary
-  uint32_t instruction = util::read<uint32_t>(ref(rom), location - (location % 4));
-
-  /*
-  Format for ARM7 instructions:
-
-  +-----------------------------------------------------+
-  |31  28|27      20|19               8|7        4|3   0|
-  |-----------------------------------------------------|
-  | COND | OPCODE 1 | PARAMETERS/OTHER | OPCODE 2 | RM  |
-  +-----------------------------------------------------+
-  */
-
-  uint8_t condition = (instruction & 0xF0000000) >> 24;
-  uint8_t opcode1 = (instruction & 0x0FF00000) >> 20;
-  uint8_t opcode2 = (instruction & 0x000000F0) >> 4;
-
-  //  When opcode1 is between 0x80 and 0xE0 it will be jumps or load/store
-  if (opcode1 >= 0x80 && opcode1 < 0xE0)
-  {
-    return false;
+    return true;
   }
 
-  //  Every even opcode1 between 0x60 and 0x80 is a load/store
-  if (opcode1 >= 0x60 && opcode1 < 0x80 && opcode2 % 2 == 0)
+  //  The whole instruction has to be inside of the rom
+  if (static_cast<uint64_t>(location - (location % 4)) + 4 > this->rom.size())
   {
-    return false;
+    return true;
   }
 
-  //  Opcode1 between 0x40 and 0x60 are all load/store
-  if (opcode1 >= 0x40 && opcode1 < 0x60)
-  {
-    return false;
-  }
-
-  //  If opcode1 is between 0x00 and 0x20
-  if (opcode1 >= 0x00 && opcode1 < 0x20)
-  {
-    if ((opcode2 & 0x0B) == 0x0B)
-    {
-      //  All opcode2 that end with 0x0B are load/store
-      return false;
-    }
-    else if (opcode1 % 2 == 1 && ((opcode2 & 0x0D) == 0x0D || (opcode2 & 0x0F) == 0x0F))
-    {
-      //  All opcode2 that end with 0x0D or 0x0F and have an odd opcode1 are load/store
-      return false;
-    }
-  }
+  //  Entire instruction is at location of the nearest 4 byte boundary
+  uint32_t instruction = util::read<uint32_t>(rom, location - (location % 4));
 
-  return true;
+  //  Jumps and load/store instructions are protected
+  return opcodes::arm::is_protected_instruction(instruction);
 }
 
 void GBACorruption::print_header()
@@ -112,13 +88,11 @@ void GBACorruption::save(std::string filename)
   {
     if (info->save_file() != "")
     {
-      util::write_file(info->save_file(), rom);
-      this->save_name = info->save_file();
+      this->save_name = this->write_rom(info->save_file(), info->patch());
     }
     else
     {
-      util::write_file(filename, rom);
-      this->save_name = filename;
+      this->save_name = this->write_rom(filename, info->patch());
     }
   }
   catch (InvalidFileNameException e)
@@ -127,3 +101,20 @@ void GBACorruption::save(std::string filename)
     exit(EXIT_FAILURE);
   }
 }
+
+/*
+  Makes a new corruption of this rom sharing its header and protections.
+
+  @param args - Arguments of the new corruption
+*/
+std::unique_ptr<Corruption> GBACorruption::variant(std::vector<std::string>& args)
+{
+  auto copy = std::make_unique<GBACorruption>();
+
+  copy->share(*this);
+  copy->header = this->header;
+  copy->info = std::make_unique<CorruptionInfo>(args);
+  copy->keep_original(copy->info->patch());
+
+  return copy;
+}
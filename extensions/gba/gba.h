@@ -4,10 +4,30 @@
 #include <string>
 
 #include "corrupt.h"
+#include "opcodes.h"
 
 #include "gba_except.h"
 #include "gba_header.h"
 
+/*
+  Protections for the ARM7 instructions of GBA roms.
+*/
+class GBAValidator : public engine::Validator<GBAValidator>
+{
+public:
+  GBAValidator(util::ByteView rom) : rom(rom) {};
+
+  inline bool valid_byte(uint8_t byte, uint32_t location) const
+  {
+    return !protected_location(location);
+  }
+
+  bool protected_location(uint32_t location) const;
+
+private:
+  util::ByteView rom;
+};
+
 class GBACorruption : public Corruption
 {
 public:
@@ -15,13 +35,16 @@ public:
   GBACorruption(std::string filename, std::vector<std::string>& args);
   ~GBACorruption();
 
+  virtual void corrupt();
   virtual void initialize(std::string filename, std::vector<std::string>& args);
   virtual bool valid();
   virtual bool valid_byte(uint8_t byte, uint32_t location);
   virtual void print_header();
   virtual void save(std::string filename);
+
+  virtual std::unique_ptr<Corruption> variant(std::vector<std::string>& args);
 private:
-  std::unique_ptr<GBAHeader> header;
+  std::shared_ptr<GBAHeader> header;
 };
 
 #endif
@@ -5,12 +5,12 @@ GBAHeader::GBAHeader()
 
 }
 
-GBAHeader::GBAHeader(std::vector<uint8_t>& rom)
+GBAHeader::GBAHeader(util::ByteView rom)
 {
   initialize(rom);
 }
 
-void GBAHeader::initialize(std::vector<uint8_t>& rom)
+void GBAHeader::initialize(util::ByteView rom)
 {
   header.resize(GBAHeader::Size);
   std::copy(rom.begin(), rom.begin() + GBAHeader::Size, header.begin());
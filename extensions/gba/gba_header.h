@@ -29,9 +29,9 @@ struct GBAHeader
   const static uint32_t MaxSize = 0x200; // Arbitrary value. Used just to be safe of multi-boot headers.
 
   GBAHeader();
-  GBAHeader(std::vector<uint8_t>&);
+  GBAHeader(util::ByteView);
 
-  void initialize(std::vector<uint8_t>&);
+  void initialize(util::ByteView);
 
   bool valid();
 
@@ -46,22 +46,22 @@ private:
 
 inline uint32_t GBAHeader::entry_point()
 {
-  return util::read<uint32_t>(ref(header), GBAOffset::Entry);
+  return util::read<uint32_t>(header, GBAOffset::Entry);
 }
 
 inline std::string GBAHeader::title()
 {
-  return util::read(ref(header), GBAOffset::Title, 12);
+  return util::read(header, GBAOffset::Title, 12);
 }
 
 inline std::string GBAHeader::game_code()
 {
-  return util::read(ref(header), GBAOffset::GameCode, 4);
+  return util::read(header, GBAOffset::GameCode, 4);
 }
 
 inline std::string GBAHeader::maker_code()
 {
-  return util::read(ref(header), GBAOffset::MakerCode, 2);
+  return util::read(header, GBAOffset::MakerCode, 2);
 }
 
 inline uint8_t GBAHeader::software_version()
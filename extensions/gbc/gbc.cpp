@@ -1,5 +1,10 @@
 #include "gbc.h"
 
+#include "formats.h"
+
+//  Start of the Nintendo logo in the header
+static formats::Registrar format({ "GBC", "", { ".gb", ".gbc" }, { { 0x104, 0xCEED6666 } }, formats::handler<GBCCorruption>() });
+
 GBCCorruption::GBCCorruption() { }
 
 GBCCorruption::GBCCorruption(std::string filename, std::vector<std::string>& args)
@@ -14,8 +19,9 @@ void GBCCorruption::initialize(std::string filename, std::vector<std::string>& a
   // Read the rom file
   rom = util::read_file(filename);
 
-  header = std::make_unique<GBCHeader>(rom);
+  header = std::make_shared<GBCHeader>(rom);
   info = std::make_unique<CorruptionInfo>(args);
+  this->keep_original(info->patch());
 
   // If the rom is not valid then throw an exception
   if (!valid())
@@ -49,65 +55,76 @@ bool GBCCorruption::valid()
   return this->header->valid_logo();
 }
 
+void GBCCorruption::corrupt()
+{
+  corrupt_rom(GBCValidator(rom));
+}
+
 bool GBCCorruption::valid_byte(uint8_t byte, uint32_t location)
 {
-  //  If location is in the header then do nothing
-  if (location < GBCHeader::Start)
-  {
-    return false;
-  }
+  return GBCValidator(rom).valid_byte(byte, location);
+}
 
-  //  Map of branch opcodes and their size
-  //  std::map<opcode, size>
-  static std::map<uint8_t, uint8_t> invalid_branch{
-    { 0xC2, 3 }, { 0xD2, 3 }, { 0xC3, 3 }, { 0xC4, 3 },
-    { 0xD4, 3 }, { 0xCA, 3 }, { 0xDA, 3 }, { 0XCC, 3 },
-    { 0xCD, 3 }, { 0xDC, 3 }, { 0x20, 2 }, { 0x30, 2 },
-    { 0x18, 2 }, { 0x28, 2 }, { 0x38, 2 }, { 0xE9, 1 }
-  };
-
-  //  List of stack operations (push/pop)
-  static std::vector<uint8_t> invalid_stack{
-    0xC1, 0xD1, 0xE1, 0xF1, 0xC5, 0xD5, 0xE5, 0xF5
-  };
-
-  //  List of 1 byte return opcodes
-  static std::vector<uint8_t> invalid_ret{
-    0xC0, 0xD0, 0xC7, 0xD7, 0xE7, 0xF7, 0xC8,
-    0xD8, 0xC9, 0xD9, 0xCF, 0xDF, 0xEF, 0xFF
-  };
+//  LR35902 opcodes that need protecting and their length including the opcode byte
+static constexpr opcodes::Opcode opcode_list[] = {
+  //  Jumps and calls
+  { 0xC2, opcodes::Branch, 3 }, { 0xD2, opcodes::Branch, 3 }, { 0xC3, opcodes::Branch, 3 }, { 0xC4, opcodes::Branch, 3 },
+  { 0xD4, opcodes::Branch, 3 }, { 0xCA, opcodes::Branch, 3 }, { 0xDA, opcodes::Branch, 3 }, { 0xCC, opcodes::Branch, 3 },
+  { 0xCD, opcodes::Branch, 3 }, { 0xDC, opcodes::Branch, 3 }, { 0xE9, opcodes::Branch, 1 },
 
-  //  If you are within the header size then don't corrupt
-  if (location < GBAHeader::Size)
-  {
-    return false;
-  }
+  //  Relative jumps
+  { 0x20, opcodes::Branch, 2 }, { 0x30, opcodes::Branch, 2 }, { 0x18, opcodes::Branch, 2 }, { 0x28, opcodes::Branch, 2 },
+  { 0x38, opcodes::Branch, 2 },
+
+  //  Push and pop, not protected yet
+  { 0xC1, opcodes::Stack, 1 }, { 0xD1, opcodes::Stack, 1 }, { 0xE1, opcodes::Stack, 1 }, { 0xF1, opcodes::Stack, 1 },
+  { 0xC5, opcodes::Stack, 1 }, { 0xD5, opcodes::Stack, 1 }, { 0xE5, opcodes::Stack, 1 }, { 0xF5, opcodes::Stack, 1 },
+
+  //  1 byte returns and restarts
+  { 0xC0, opcodes::Return, 1 }, { 0xD0, opcodes::Return, 1 }, { 0xC7, opcodes::Return, 1 }, { 0xD7, opcodes::Return, 1 },
+  { 0xE7, opcodes::Return, 1 }, { 0xF7, opcodes::Return, 1 }, { 0xC8, opcodes::Return, 1 }, { 0xD8, opcodes::Return, 1 },
+  { 0xC9, opcodes::Return, 1 }, { 0xD9, opcodes::Return, 1 }, { 0xCF, opcodes::Return, 1 }, { 0xDF, opcodes::Return, 1 },
+  { 0xEF, opcodes::Return, 1 }, { 0xFF, opcodes::Return, 1 }
+};
 
-  if (std::find(invalid_ret.begin(), invalid_ret.end(), this->rom[location]) != invalid_ret.end() ||
-      std::find(invalid_ret.begin(), invalid_ret.end(), byte) != invalid_ret.end())
+static constexpr opcodes::Table opcode_table = opcodes::make_table(opcode_list);
+
+/*
+  Determines whether a byte value can be written anywhere in the rom.
+
+  @param byte - The byte that needs to be checked
+
+  @return true if the byte is neither a return nor a branch opcode.
+*/
+bool GBCValidator::valid_value(uint8_t byte)
+{
+  return !opcode_table.is(byte, opcodes::Branch | opcodes::Return);
+}
+
+/*
+  Determines whether a location is in the header or inside of a return or
+  branch instruction.
+
+  @param location - The offset in the rom
+
+  @return true if nothing may be written at @location.
+*/
+bool GBCValidator::protected_location(uint32_t location) const
+{
+  //  If location is in the header then do nothing
+  if (location < GBCHeader::Start || location >= this->rom.size())
   {
-    //  If replaced byte or current byte is a 1 byte ret opcode then it isn't safe to replace
-    return false;
+    return true;
   }
 
-  //  Check if we are a branch opcode or the parameter of a branch opcode
-  for (auto& branch : invalid_branch)
+  //  If you are within the header size then don't corrupt
+  if (location < GBAHeader::Size)
   {
-    auto opcode = branch.first;
-    auto size = branch.second;
-
-    //  Check up to [size] bytes behind us to make sure this location or byte value isn't a branch parameter
-    for (int i = 0; i < size; i++)
-    {
-      //  If it is then it is not valid
-      if (this->rom[location - i] == opcode || byte == opcode)
-      {
-        return false;
-      }
-    }
+    return true;
   }
 
-  return true;
+  //  Returns are only 1 byte so they are covered the same way as branches
+  return opcode_table.covers(&this->rom[0], location, opcodes::Branch | opcodes::Return);
 }
 
 void GBCCorruption::save(std::string filename)
@@ -124,13 +141,11 @@ void GBCCorruption::save(std::string filename)
   {
     if (info->save_file() != "")
     {
-      util::write_file(info->save_file(), rom);
-      this->save_name = info->save_file();
+      this->save_name = this->write_rom(info->save_file(), info->patch());
     }
     else
     {
-      util::write_file(filename, rom);
-      this->save_name = filename;
+      this->save_name = this->write_rom(filename, info->patch());
     }
   }
   catch (InvalidFileNameException e)
@@ -138,4 +153,21 @@ void GBCCorruption::save(std::string filename)
     std::cout << e.what() << std::endl;
     exit(EXIT_FAILURE);
   }
-}
\ No newline at end of file
+}
+
+/*
+  Makes a new corruption of this rom sharing its header and protections.
+
+  @param args - Arguments of the new corruption
+*/
+std::unique_ptr<Corruption> GBCCorruption::variant(std::vector<std::string>& args)
+{
+  auto copy = std::make_unique<GBCCorruption>();
+
+  copy->share(*this);
+  copy->header = this->header;
+  copy->info = std::make_unique<CorruptionInfo>(args);
+  copy->keep_original(copy->info->patch());
+
+  return copy;
+}
@@ -31,10 +31,31 @@
 */
 
 #include "corrupt.h"
+#include "opcodes.h"
 
 #include "gbc_except.h"
 #include "gbc_header.h"
 
+/*
+  Opcode protections for Gameboy and Gameboy Color roms.
+*/
+class GBCValidator : public engine::Validator<GBCValidator>
+{
+public:
+  GBCValidator(util::ByteView rom) : rom(rom) {};
+
+  inline bool valid_byte(uint8_t byte, uint32_t location) const
+  {
+    return valid_value(byte) && !protected_location(location);
+  }
+
+  bool protected_location(uint32_t location) const;
+  static bool valid_value(uint8_t byte);
+
+private:
+  util::ByteView rom;
+};
+
 class GBCCorruption : public Corruption
 {
 public:
@@ -42,13 +63,16 @@ public:
   GBCCorruption(std::string filename, std::vector<std::string>& args);
   ~GBCCorruption();
 
+  virtual void corrupt();
   virtual void initialize(std::string filename, std::vector<std::string>& args);
   virtual void print_header();
   virtual bool valid();
   virtual void save(std::string filename);
 
+  virtual std::unique_ptr<Corruption> variant(std::vector<std::string>& args);
+
 private:
-  std::unique_ptr<GBCHeader> header;
+  std::shared_ptr<GBCHeader> header;
 
   bool valid_byte(uint8_t byte, uint32_t location);
 };
@@ -5,12 +5,12 @@ GBCHeader::GBCHeader()
 
 }
 
-GBCHeader::GBCHeader(std::vector<uint8_t>& rom)
+GBCHeader::GBCHeader(util::ByteView rom)
 {
   this->initialize(rom);
 }
 
-void GBCHeader::initialize(std::vector<uint8_t>& rom)
+void GBCHeader::initialize(util::ByteView rom)
 {
   this->header.reserve(0x50);
   std::copy(rom.begin() + GBCOffset::Start, rom.begin() + GBCOffset::End, std::back_inserter(this->header));
@@ -18,7 +18,7 @@ void GBCHeader::initialize(std::vector<uint8_t>& rom)
 
 uint16_t GBCHeader::entry()
 {
-  return util::read<uint16_t>(ref(header), GBCLocal::Entry);
+  return util::read<uint16_t>(header, GBCLocal::Entry);
 }
 
 bool GBCHeader::valid_logo()
@@ -59,7 +59,7 @@ uint32_t GBCHeader::manufacturer()
   //  Manufacturer is only set when the CGB flag is active
   if (this->cgb() & 0x80)
   {
-    return util::read<uint32_t>(ref(header), GBCLocal::Manufacturer);
+    return util::read<uint32_t>(header, GBCLocal::Manufacturer);
   }
 
   //  No CGB flag, no manufacturer
@@ -73,7 +73,7 @@ uint8_t GBCHeader::cgb()
 
 uint16_t GBCHeader::company()
 {
-  return util::read<uint16_t>(ref(header), GBCLocal::Company);
+  return util::read<uint16_t>(header, GBCLocal::Company);
 }
 
 uint8_t GBCHeader::sgb()
@@ -75,9 +75,9 @@ public:
   static const uint32_t LogoSize = 0x30;
 
   GBCHeader();
-  GBCHeader(std::vector<uint8_t>& rom);
+  GBCHeader(util::ByteView rom);
 
-  void initialize(std::vector<uint8_t>& rom);
+  void initialize(util::ByteView rom);
   
   uint16_t entry();
   bool valid_logo();
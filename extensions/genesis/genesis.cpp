@@ -1,5 +1,10 @@
 #include "genesis.h"
 
+#include "formats.h"
+
+//  System name of the header, interleaved .smd files are only known by extension
+static formats::Registrar format({ "Genesis", "", { ".bin", ".md", ".smd" }, { { 0x100, formats::fourcc("SEGA") }, { 0x100, formats::fourcc(" SEG") } }, formats::handler<GenesisCorruption>() });
+
 GenesisCorruption::GenesisCorruption()
 {
 
@@ -20,7 +25,8 @@ void GenesisCorruption::initialize(std::string filename, std::vector<std::string
   // Read the rom file
   rom = util::read_file(filename);
   info = std::make_unique<CorruptionInfo>(args);
-  header = std::make_unique<GenesisHeader>(rom);
+  this->keep_original(info->patch());
+  header = std::make_shared<GenesisHeader>(rom);
 
   // If the rom is not valid then throw an exception
   if (!valid())
@@ -29,6 +35,11 @@ void GenesisCorruption::initialize(std::string filename, std::vector<std::string
   }
 }
 
+void GenesisCorruption::corrupt()
+{
+  corrupt_rom(GenesisValidator(rom, header->begin()));
+}
+
 /*
   Determines whether or not a given byte is valid to include into the rom.
 
@@ -38,36 +49,45 @@ void GenesisCorruption::initialize(std::string filename, std::vector<std::string
   @return true if the byte can be added at @location in the rom.
 */
 bool GenesisCorruption::valid_byte(uint8_t byte, uint32_t location)
+{
+  return GenesisValidator(rom, header->begin()).valid_byte(byte, location);
+}
+
+/*
+  Determines whether a 68000 instruction word is a branch, jump or return.
+
+  @param instruction - The first word of the instruction
+*/
+static constexpr bool is_branch(uint32_t instruction)
+{
+  return ((instruction & 0xF000) == 0x6000 ||  //  Bcc, BSR and BRA
+          instruction == 0x4E75 ||             //  RTS
+          instruction == 0x4E77 ||             //  RTR
+          instruction == 0x4E74 ||             //  RTD
+          (instruction & 0xFFC0) == 0x4E80 ||  //  JSR
+          (instruction & 0xFFC0) == 0x4EC0 ||  //  JMP
+          (instruction & 0xF0F8) == 0x50C8);   //  DBcc
+}
+
+//  One bit for every possible instruction word
+static constexpr opcodes::BitTable<0x10000> branch_table = opcodes::make_bit_table<0x10000>(is_branch);
+
+bool GenesisValidator::protected_location(uint32_t location) const
 {
   //  If location is in the header then do nothing
-  if (location < header->begin())
+  if (location < this->begin)
   {
-    return false;
+    return true;
   }
 
-  if (is_branch(util::read_big<uint16_t>(rom, location)) ||
-      is_branch(util::read_big<uint16_t>(rom, location - 1)))
+  //  Both instruction words around the location have to be inside of the rom
+  if (location == 0 || location + 1 >= this->rom.size())
   {
-    return false;
+    return true;
   }
 
-  return true;
-}
-
-bool GenesisCorruption::is_branch(uint16_t instruction)
-{
-  uint8_t hi_byte = (instruction & 0xFF00) >> 8;
-  uint8_t hi_nybble = (instruction & 0xF000) >> 12;
-
-  return (hi_nybble == 0x06 ||  //  Bcc
-          hi_byte == 0x61 || // BSR
-          hi_byte == 0x60 || // BRA
-          hi_byte == 0x4E75 ||  //  RTS
-          hi_byte == 0x4E77 ||  //  RTR
-          hi_byte == 0x4E74 ||  //  RTD
-          (instruction & 0xFFC0) == 0x4E80 || //  JSR
-          (instruction & 0xFFC0) == 0x4EC0 || //  JMP
-          (instruction & 0xF0F8) == 0x50C8);  //DBcc
+  return branch_table.test(util::read_big<uint16_t>(rom, location)) ||
+         branch_table.test(util::read_big<uint16_t>(rom, location - 1));
 }
 
 /*
@@ -141,13 +161,11 @@ void GenesisCorruption::save(std::string filename)
   {
     if (info->save_file() != "")
     {
-      util::write_file(info->save_file(), rom);
-      this->save_name = info->save_file();
+      this->save_name = this->write_rom(info->save_file(), info->patch());
     }
     else
     {
-      util::write_file(filename, rom);
-      this->save_name = filename;
+      this->save_name = this->write_rom(filename, info->patch());
     }
   }
   catch (InvalidFileNameException e)
@@ -170,4 +188,21 @@ uint16_t GenesisCorruption::checksum()
   //debug::cout << "Checksum: " << std::hex << sum << std::dec << std::endl;
 
   return sum;
-}
\ No newline at end of file
+}
+
+/*
+  Makes a new corruption of this rom sharing its header and protections.
+
+  @param args - Arguments of the new corruption
+*/
+std::unique_ptr<Corruption> GenesisCorruption::variant(std::vector<std::string>& args)
+{
+  auto copy = std::make_unique<GenesisCorruption>();
+
+  copy->share(*this);
+  copy->header = this->header;
+  copy->info = std::make_unique<CorruptionInfo>(args);
+  copy->keep_original(copy->info->patch());
+
+  return copy;
+}
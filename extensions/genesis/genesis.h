@@ -2,10 +2,31 @@
 #define _GENESIS_CORRUPTION_H
 
 #include "corrupt.h"
+#include "opcodes.h"
 
 #include "genesis_except.h"
 #include "genesis_header.h"
 
+/*
+  Protections for the 68000 branch instructions of Genesis roms.
+*/
+class GenesisValidator : public engine::Validator<GenesisValidator>
+{
+public:
+  GenesisValidator(util::ByteView rom, uint32_t begin) : rom(rom), begin(begin) {};
+
+  inline bool valid_byte(uint8_t byte, uint32_t location) const
+  {
+    return !protected_location(location);
+  }
+
+  bool protected_location(uint32_t location) const;
+
+private:
+  util::ByteView rom;
+  uint32_t begin;
+};
+
 class GenesisCorruption : public Corruption
 {
 public:
@@ -13,16 +34,17 @@ public:
   GenesisCorruption(std::string filename, std::vector<std::string>& args);
   ~GenesisCorruption();
 
+  virtual void corrupt();
   virtual void initialize(std::string filename, std::vector<std::string>& args);
   virtual bool valid();
   virtual bool valid_byte(uint8_t byte, uint32_t location);
   virtual void print_header();
   virtual void save(std::string filename);
 
-private:
-  std::unique_ptr<GenesisHeader> header;
+  virtual std::unique_ptr<Corruption> variant(std::vector<std::string>& args);
 
-  static bool is_branch(uint16_t instruction);
+private:
+  std::shared_ptr<GenesisHeader> header;
 
   uint16_t checksum();
 };
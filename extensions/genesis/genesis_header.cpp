@@ -5,7 +5,7 @@ GenesisHeader::GenesisHeader()
 
 }
 
-GenesisHeader::GenesisHeader(std::vector<uint8_t>& rom)
+GenesisHeader::GenesisHeader(util::ByteView rom)
 {
   initialize(rom);
 }
@@ -15,7 +15,7 @@ GenesisHeader::~GenesisHeader()
 
 }
 
-void GenesisHeader::initialize(std::vector<uint8_t>& rom)
+void GenesisHeader::initialize(util::ByteView rom)
 {
   header.resize(0x200);
   std::copy(rom.begin(), rom.begin() + 0x200, header.begin());
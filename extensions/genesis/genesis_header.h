@@ -31,10 +31,10 @@ struct GenesisHeader
   static const int Header_Size = 64;
 
   GenesisHeader();
-  GenesisHeader(std::vector<uint8_t> &rom);
+  GenesisHeader(util::ByteView rom);
   ~GenesisHeader();
 
-  void initialize(std::vector<uint8_t>&);
+  void initialize(util::ByteView);
   uint16_t checksum();
   uint32_t begin();
   uint32_t end();
@@ -1,5 +1,91 @@
 #include "img.h"
 
+#include <cstring>
+
+#include "rng.h"
+#include "thread_pool.h"
+
+/*
+  Puts a path in the form the index uses: uppercase, separated by single
+  forward slashes and without a leading slash or "." directories.
+
+  @param path - The path to normalize
+
+  @return the normalized path.
+*/
+static std::string normalize(std::string path)
+{
+  std::replace(path.begin(), path.end(), '\\', '/');
+  std::transform(path.begin(), path.end(), path.begin(), ::toupper);
+
+  std::string result;
+
+  for (auto& part : util::split(path, "/", false))
+  {
+    if (part == ".")
+    {
+      continue;
+    }
+
+    if (!result.empty())
+    {
+      result += "/";
+    }
+
+    result += part;
+  }
+
+  return result;
+}
+
+/*
+  Matches a path against a pattern where * is any amount of characters
+  and ? is any one character, neither of which go past a slash.
+
+  @param pattern - The normalized pattern
+  @param name - The normalized path
+
+  @return whether the path matches.
+*/
+static bool matches(const std::string& pattern, const std::string& name)
+{
+  size_t p = 0;
+  size_t n = 0;
+  size_t star = std::string::npos;  //  Last * in the pattern
+  size_t mark = 0;                  //  Where the name was when the last * was reached
+
+  while (n < name.size())
+  {
+    if (p < pattern.size() && ((pattern[p] == '?' && name[n] != '/') || pattern[p] == name[n]))
+    {
+      p++;
+      n++;
+    }
+    else if (p < pattern.size() && pattern[p] == '*')
+    {
+      star = p++;
+      mark = n;
+    }
+    else if (star != std::string::npos && name[mark] != '/')
+    {
+      //  Let the last * take one more character and try again
+      p = star + 1;
+      n = ++mark;
+    }
+    else
+    {
+      return false;
+    }
+  }
+
+  while (p < pattern.size() && pattern[p] == '*')
+  {
+    p++;
+  }
+
+  return p == pattern.size();
+}
+
 IMG::IMG()
 {
 
@@ -80,9 +166,9 @@ IMG::IMG(std::string filename, bool has_headers)
     throw IMGException("Header is not valid.");
   }
 
-  this->block_size = util::read<uint16_t>(ref(raw), 0x80); //  Read fake block size
-  this->path_table_size = util::read<uint32_t>(ref(raw), 0x84); //  Read path table size
-  this->path_table_location = util::read<uint32_t>(ref(raw), 0x8C); //  Read path table location (LSB)
+  this->block_size = util::read<uint16_t>(raw, 0x80); //  Read fake block size
+  this->path_table_size = util::read<uint32_t>(raw, 0x84); //  Read path table size
+  this->path_table_location = util::read<uint32_t>(raw, 0x8C); //  Read path table location (LSB)
 
   //  Clear contents and prepare to read the global path table
   raw.clear();
@@ -121,6 +207,7 @@ IMG::IMG(std::string filename, bool has_headers)
   img.close();
 
   this->m_filename = filename;
+  this->build_index();
 }
 
 IMG::~IMG()
@@ -129,81 +216,329 @@ IMG::~IMG()
 }
 
 /*
-  @return the contents of the filename provided or an empty vector if it doesn't exist in the image.
+  @param filename - Path of the file in the image, in any case
+
+  @return the entry of the file, throws FileNotFoundException if it doesn't exist in the image.
 */
 Entry IMG::operator[](std::string filename)
 {
-  //  Convert to uppercase
-  std::transform(filename.begin(), filename.end(), filename.begin(), ::toupper);
+  auto found = this->m_index.find(normalize(filename));
+
+  if (found == this->m_index.end())
+  {
+    throw FileNotFoundException("File '" + filename + "' not found.");
+  }
+
+  return found->second;
+}
+
+/*
+  Lists the files in the image that match a pattern. A pattern without
+  wildcards names a directory and lists everything under it.
+
+  @param pattern - A directory or a pattern with * and ? in it
+
+  @return the normalized paths of the files, sorted.
+*/
+std::vector<std::string> IMG::list(std::string pattern)
+{
+  pattern = normalize(pattern);
+
+  bool wildcard = pattern.find_first_of("*?") != std::string::npos;
+  std::string prefix = wildcard ? pattern.substr(0, pattern.find_first_of("*?")) : (pattern.empty() ? "" : pattern + "/");
+  std::vector<std::string> result;
+
+  //  Every match starts with the prefix, so only that part of the sorted names is checked
+  for (auto it = std::lower_bound(this->m_names.begin(), this->m_names.end(), prefix);
+       it != this->m_names.end() && it->compare(0, prefix.size(), prefix) == 0; ++it)
+  {
+    if (!wildcard || matches(pattern, *it))
+    {
+      result.push_back(*it);
+    }
+  }
+
+  return result;
+}
+
+/*
+  Expands the patterns in a list of files, leaving other names as they are.
+
+  @param files - Files and patterns given by the user
+
+  @return the files with every pattern replaced by its matches.
+*/
+std::vector<std::string> IMG::expand(const std::vector<std::string>& files)
+{
+  std::vector<std::string> result;
+
+  for (auto& file : files)
+  {
+    if (file.find_first_of("*?") == std::string::npos)
+    {
+      result.push_back(file);
+      continue;
+    }
+
+    auto found = this->list(file);
+    result.insert(result.end(), found.begin(), found.end());
+  }
+
+  return result;
+}
+
+/*
+  Finds the files to work on and puts them in the order they are stored on
+  the image, so reading them is a single pass from the start of the image
+  to the end instead of seeking back and forth in the order they were
+  given. Files that touch or overlap are joined into one extent.
+
+  @param files - Files and patterns given by the user, empty names are skipped
+
+  @return the extents in order of their location, throws FileNotFoundException
+          if a file doesn't exist in the image.
+*/
+std::vector<IMG::Extent> IMG::schedule(const std::vector<std::string>& files)
+{
+  std::vector<std::pair<std::string, Entry>> entries;
+  std::vector<std::pair<uint32_t, size_t>> order;  //  Location and index of each entry
+
+  for (auto& file : this->expand(files))
+  {
+    if (file != "")
+    {
+      entries.emplace_back(file, (*this)[file]);
+      order.emplace_back(entries.back().second.location(1), order.size());
+    }
+  }
 
-  uint16_t index = 0;           //  Current index of directory
-  uint16_t last_index = 0;      //  Flag for parent directory
-  uint32_t location = 0;        //  Unique location of current directory
-  std::shared_ptr<Path> parent = nullptr; //  Path that holds the file requested
+  //  Ties keep the order the files were given in
+  std::sort(order.begin(), order.end());
 
-  //  Get the directories from the filename and the filename itself
-  std::vector<std::string> directories = util::split(filename, "/", false);
-  std::string file = directories.back();
+  std::vector<Extent> extents;
 
-  //  Remove last entry which was the file name
-  directories.pop_back();
+  for (auto& index : order)
+  {
+    auto& entry = entries[index.second];
+    uint32_t sector = index.first;
+    uint32_t end = sector + entry.second.sectors();
 
-  //  Loop through directory names
-  for (auto& dir : directories)
+    if (extents.empty() || sector > extents.back().end)
+    {
+      extents.push_back(Extent{ sector, end, {} });
+    }
+
+    extents.back().end = std::max(extents.back().end, end);
+    extents.back().files.push_back(entry);
+  }
+
+  return extents;
+}
+
+/*
+  Corrupts files of the image without changing it. The image is only read
+  and the changes are recorded as edits in the coordinates of the image,
+  to be written to the output when saving.
+
+  Files are worked on in the order they are stored, see schedule. Extents
+  don't share sectors, so they are corrupted at the same time. Each one
+  keeps its own edits and count, which are merged in order of location so
+  the output doesn't depend on which extent finishes first.
+
+  @param files - Files and patterns given by the user
+  @param options - Operation, value and range of the corruption, relative to each file
+  @param seed - Seed of the corruption, each file draws from a stream keyed by its path
+  @param edits - Recorder the changes are added to
+
+  @return the amount of bytes that were corrupted.
+*/
+uint64_t IMG::corrupt(const std::vector<std::string>& files, const engine::Options& options, uint64_t seed, patch::Recorder& edits)
+{
+  util::MappedFile image(this->m_filename, false, util::Access::Sequential);
+
+  if (image.empty())
   {
-    index = 0;  //  Current index of directory starts at 0 (root)
+    throw IMGOpenException();
+  }
+
+  auto extents = this->schedule(files);
 
-    //  For each Path in the list
-    for (auto& path : this->root)
+  std::vector<patch::Recorder> changes(extents.size());
+  std::vector<uint64_t> counts(extents.size(), 0);
+
+  ThreadPool::shared().parallel_for(extents.size(), [&](uint64_t index)
+  {
+    for (auto& file : extents[index].files)
     {
-      std::string curpath = path->identifier();
-      std::transform(curpath.begin(), curpath.end(), curpath.begin(), ::toupper);
+      Entry& entry = file.second;
+      std::vector<uint8_t> data;
 
-      //  Check if the parent of this Path is the last index and if the name matches the one being searched for
-      if (path->parent_index() == last_index && dir == curpath)
+      try
+      {
+        data = entry.get(image, this->has_headers);
+      }
+      catch (...)
       {
-        //  If it does set the next search up
-        last_index = index;           //  Index of this directory
-        location = path->location();  //  Unique location of this directory
-        break;  //  Stop searching
+        //debug::cout << "Could not find file '" << file.first << "'" << std::endl;
+        continue;
       }
 
-      index++;  //  Increase directory index
+      //  If no data, then there is nothing to corrupt
+      if (data.empty())
+      {
+        continue;
+      }
+
+      //  Keep the original data to find what changed
+      std::vector<uint8_t> original(data);
+
+      counts[index] += engine::corrupt(data, options, engine::Unprotected(), rng::derive(seed, rng::hash(file.first)));
+
+      for (uint32_t i = 0; i < data.size(); i++)
+      {
+        if (data[i] != original[i])
+        {
+          changes[index].record(entry.image_offset(i, this->has_headers), data[i]);
+        }
+      }
     }
+  });
+
+  uint64_t corruptions = 0;
+
+  for (uint64_t i = 0; i < extents.size(); i++)
+  {
+    corruptions += counts[i];
+    edits.append(std::move(changes[i]));
   }
 
-  //  Finialize the search by looping through all Path's to find the one with the correct location
-  for (auto& path : this->root)
+  return corruptions;
+}
+
+/*
+  Updates the EDC and ECC of every raw sector that has edits, recording the
+  new values as edits too. Only the touched sectors are read, and images
+  without sector headers have no EDC or ECC to update.
+
+  @param edits - Edits to the image, in the coordinates of the image
+*/
+void IMG::regenerate(patch::Recorder& edits)
+{
+  //  Sectors are done in batches to bound the memory for a corruption of the whole disc
+  static const uint32_t Batch = 0x400;
+
+  if (!this->has_headers || this->real_block_size != sector::Size || edits.empty())
   {
-    //  If the unique location matches
-    if (location == path->location())
+    return;
+  }
+
+  util::MappedFile image(this->m_filename, false);
+  const auto& runs = edits.runs();
+  //  Kept apart until the end, recording into edits would move its runs
+  patch::Recorder regenerated;
+  uint64_t count = image.size() / sector::Size;
+  std::vector<uint64_t> sectors;
+
+  for (auto& run : runs)
+  {
+    uint64_t first = run.offset / sector::Size;
+    uint64_t last = std::min(count, (run.offset + run.bytes.size() + sector::Size - 1) / sector::Size);
+
+    for (uint64_t i = first; i < last; i++)
     {
-      //  Set the parent path as the one found
-      parent = path;
+      if (sectors.empty() || sectors.back() < i)
+      {
+        sectors.push_back(i);
+      }
     }
   }
 
-  if (parent == nullptr)
+  std::vector<uint8_t> raw(Batch * sector::Size);
+  auto run = runs.begin();
+
+  for (size_t start = 0; start < sectors.size(); start += Batch)
   {
-    throw FileNotFoundException("File " + filename + " not found. No parent directory.");
+    size_t amount = std::min<size_t>(Batch, sectors.size() - start);
+
+    //  Rebuild each sector as it will be written, runs and sectors are both sorted
+    for (size_t i = 0; i < amount; i++)
+    {
+      uint64_t offset = sectors[start + i] * sector::Size;
+      uint8_t* buffer = &raw[i * sector::Size];
+
+      std::memcpy(buffer, image.data() + offset, sector::Size);
+
+      while (run != runs.end() && run->offset + run->bytes.size() <= offset)
+      {
+        ++run;
+      }
+
+      for (auto it = run; it != runs.end() && it->offset < offset + sector::Size; ++it)
+      {
+        uint64_t first = std::max(it->offset, offset);
+        uint64_t last = std::min(it->offset + it->bytes.size(), offset + sector::Size);
+
+        std::memcpy(buffer + (first - offset), it->bytes.data() + (first - it->offset), last - first);
+      }
+    }
+
+    ThreadPool::shared().parallel_for(amount, [&raw](uint64_t i)
+    {
+      sector::regenerate(&raw[i * sector::Size]);
+    });
+
+    //  Everything from the EDC on, the data is already in the edits
+    for (size_t i = 0; i < amount; i++)
+    {
+      uint64_t offset = sectors[start + i] * sector::Size;
+
+      for (uint32_t j = 0x810; j < sector::Size; j++)
+      {
+        if (raw[i * sector::Size + j] != image[offset + j])
+        {
+          regenerated.record(offset + j, raw[i * sector::Size + j]);
+        }
+      }
+    }
   }
 
-  //  For each file entry in the directory
-  for (auto& entry : parent->entries())
+  edits.append(std::move(regenerated));
+}
+
+/*
+  Builds the index of every file by its full path. Directories in the path
+  table always come after their parent, so the path of the parent is known
+  by the time a directory is reached.
+*/
+void IMG::build_index()
+{
+  std::vector<std::string> directories(this->root.size());
+
+  for (size_t i = 0; i < this->root.size(); i++)
   {
-    std::string curentry = entry.name();
-    std::transform(curentry.begin(), curentry.end(), curentry.begin(), ::toupper);
+    auto& path = this->root[i];
+    uint16_t parent = path->parent_index();
+
+    //  The first path is the root, which is its own parent
+    if (i > 0 && parent < i)
+    {
+      directories[i] = normalize(directories[parent] + "/" + path->identifier());
+    }
 
-    //std::cout << file << "\t" << curentry << "\t" << std::hex << entry.location(0x800) << std::dec << std::endl;
-    //  If the file name matches then return the entry
-    if (curentry == file)
+    for (auto& entry : path->entries())
     {
-      return entry;
+      this->m_index.emplace(normalize(directories[i] + "/" + entry.name()), entry);
     }
   }
 
-  //  No match, no file
-  throw FileNotFoundException("File '" + filename + "' not found.");
+  this->m_names.reserve(this->m_index.size());
+
+  for (auto& file : this->m_index)
+  {
+    this->m_names.push_back(file.first);
+  }
+
+  std::sort(this->m_names.begin(), this->m_names.end());
 }
 
 void IMG::directories()
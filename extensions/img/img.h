@@ -78,11 +78,15 @@
 #include <string>
 #include <fstream>
 #include <cstdint>
+#include <unordered_map>
 
 #include "img_entry.h"
 #include "img_except.h"
 #include "img_path.h"
+#include "img_sector.h"
 
+#include "engine.h"
+#include "patch.h"
 #include "util.h"
 
 class IMG
@@ -90,11 +94,26 @@ class IMG
 public:
   static const uint8_t SectionHeaderSize = 0x18;
 
+  /*
+    Files whose sectors follow each other on the image, in order.
+  */
+  struct Extent
+  {
+    uint32_t sector;  //  First sector
+    uint32_t end;     //  Sector past the last one
+    std::vector<std::pair<std::string, Entry>> files;
+  };
+
   IMG();
   IMG(std::string filename, bool has_headers = true);
   ~IMG();
 
   Entry operator[](std::string file);
+  std::vector<std::string> list(std::string pattern);
+  std::vector<std::string> expand(const std::vector<std::string>& files);
+  std::vector<Extent> schedule(const std::vector<std::string>& files);
+  uint64_t corrupt(const std::vector<std::string>& files, const engine::Options& options, uint64_t seed, patch::Recorder& edits);
+  void regenerate(patch::Recorder& edits);
   std::string to_json();
 
   void directories();
@@ -104,6 +123,11 @@ private:
   std::vector<std::shared_ptr<Path>> root;
   std::string m_filename;
 
+  //  Every file by its full uppercase path, built once when the image is loaded
+  std::unordered_map<std::string, Entry> m_index;
+  //  The same paths sorted, for listing directories
+  std::vector<std::string> m_names;
+
   uint32_t real_block_size;
   uint32_t block_size;
   uint32_t path_table_size;
@@ -112,6 +136,7 @@ private:
   bool has_headers;
 
   uint32_t get_offset(std::fstream& file);
+  void build_index();
   void print_tree();
 };
 
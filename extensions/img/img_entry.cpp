@@ -1,11 +1,13 @@
 #include "img_entry.h"
 
+#include <cstring>
+
 Entry::Entry()
 {
 
 }
 
-Entry::Entry(std::vector<uint8_t>& data, uint32_t r_blocksize, uint32_t l_blocksize)
+Entry::Entry(util::ByteView data, uint32_t r_blocksize, uint32_t l_blocksize)
 {
   m_size = util::read<uint8_t>(data, EntryOffset::Size);
   m_extended_size = util::read<uint8_t>(data, EntryOffset::Extended);
@@ -66,7 +68,7 @@ bool Entry::is_directory()
 
   @return True if the entry is a directory
 */
-bool Entry::is_directory(std::vector<uint8_t>& entry)
+bool Entry::is_directory(util::ByteView entry)
 {
   return !Entry::is_file(entry);
 }
@@ -76,7 +78,7 @@ bool Entry::is_directory(std::vector<uint8_t>& entry)
 
   @return True if the entry is a file
 */
-bool Entry::is_file(std::vector<uint8_t>& entry)
+bool Entry::is_file(util::ByteView entry)
 {
   //  Read in the file identifier length to know how long the identifier is
   uint8_t file_id_length = util::read<uint8_t>(entry, EntryOffset::FileIdentifierLength);
@@ -98,6 +100,14 @@ uint32_t Entry::location(uint32_t blocksize)
   return m_location * blocksize;
 }
 
+/*
+  @return the amount of sectors the entry's data takes up on the image
+*/
+uint32_t Entry::sectors()
+{
+  return (m_data_length + m_logical_block_size - 1) / m_logical_block_size;
+}
+
 /*
   @return the size in bytes of the entry's data
 */
@@ -115,95 +125,61 @@ std::string Entry::name()
 }
 
 /*
-  Reads the raw contents of a file on the image and returns it without sequence headers or junk data.
-  The fstream will be placed back at the position it was in before the call.
-
-  @param source - An open file stream to read the data from.
+  @param offset - Offset into the raw data of the file
+  @param count - Amount of raw data
+  @param skip - Whether the sectors have headers and junk data
 
-  @return raw contents of the file.
+  @return the amount of image bytes from the sector of offset to the end of the last byte.
 */
-std::vector<uint8_t> Entry::get(std::fstream& source, bool junk)
+uint64_t Entry::span(uint32_t offset, uint32_t count, bool skip)
 {
-  std::streampos fpos = source.tellg();
-  std::vector<uint8_t> data(this->size());
-
-  uint32_t dataread = 0;
-  uint32_t junksize = junk ? this->m_real_block_size - this->m_logical_block_size - Entry::SectionHeaderSize : 0;
-
-  source.seekg(this->location(this->m_real_block_size) + (junk ? SectionHeaderSize : 0), std::ios::beg);
-
-  if (this->size() <= this->m_logical_block_size)
-  {
-    source.read(reinterpret_cast<char *>(&data[0]), this->size());
-  }
-  else
+  if (count == 0)
   {
-    while (dataread < this->size() - this->m_logical_block_size)
-    {
-      source.read(reinterpret_cast<char *>(&data[dataread]), this->m_logical_block_size);
-      dataread += this->m_logical_block_size;
-
-      if (junk)
-      {
-        source.seekg(junksize, std::ios::cur);
-      }
-    }
-
-    source.read(reinterpret_cast<char *>(&data[dataread]), this->size() - dataread);
+    return 0;
   }
 
-  source.seekg(fpos, std::ios::beg);
-
-  return data;
+  return this->image_offset(offset + count - 1, skip) - this->image_offset(offset, skip) + 1;
 }
 
 /*
-  Write raw data to the location where the original file is stored on the img
+  Reads the raw contents of a file on an image mapped into memory, without
+  sequence headers or junk data. The data of each sector is copied with a
+  single memcpy. Throws std::out_of_range if the image ends before the file
+  does.
+
+  @param image - The whole image
+  @param junk - Whether the sectors have headers and junk data
 
-  @param dest - Open file stream of the img to write to
-  @param data - Raw data that matches the size of the file it will overwrite
+  @return raw contents of the file.
 */
-void Entry::write(std::fstream& dest, std::vector<uint8_t> data, bool skip)
+std::vector<uint8_t> Entry::get(util::ByteView image, bool junk)
 {
-  //  Data to write does not match the entry size, do nothing
-  if (data.size() != this->size())
+  std::vector<uint8_t> data(this->size());
+  util::ByteView sectors = image.sub(this->image_offset(0, junk), this->span(0, this->size(), junk));
+  uint32_t stride = junk ? this->m_real_block_size : this->m_logical_block_size;
+  const uint8_t* sector = sectors.data();
+
+  for (size_t done = 0; done < data.size(); done += this->m_logical_block_size, sector += stride)
   {
-    return;
+    std::memcpy(&data[done], sector, std::min<size_t>(this->m_logical_block_size, data.size() - done));
   }
 
-  //  Store stream size so it can be returned to at the end
-  std::streampos fpos = dest.tellg();
-  //  Total bytes written to the file so far
-  uint32_t written = 0;
-  //  Amount of junk between sectors of the img
-  uint32_t junksize = skip ? this->m_real_block_size - this->m_logical_block_size - SectionHeaderSize : 0;
-
-  //  Move to the file location
-  dest.seekg(this->location(this->m_real_block_size) + (skip ? SectionHeaderSize : 0), std::ios::beg);
+  return data;
+}
 
-  if (data.size() <= this->m_logical_block_size)
-  {
-    //  Since we're less than block size we should do it in a single write
-    dest.write(reinterpret_cast<char *>(&data[0]), data.size());
-  }
-  else
-  {
-    //  While we haven't written the full amount
-    while (written < data.size() - this->m_logical_block_size)
-    {
-      //  Write the max concurrent size possible to the disk
-      dest.write(reinterpret_cast<char *>(&data[written]), this->m_logical_block_size);
-      //  Increase amount written
-      written += this->m_logical_block_size;
+/*
+  Finds where a byte of the file is stored on the img
 
-      //  Skip the junk section at the end of the sector
-      dest.seekg(junksize, std::ios::cur);
-    }
+  @param offset - Offset into the raw data of the file, as returned by get
+  @param skip - Whether the sectors have headers and junk data, same as for get
 
-    //  Write any extra data to the file if it has an odd size
-    dest.write(reinterpret_cast<char *>(&data[written]), data.size() - written);
-  }
+  @return the offset of the byte in the img.
+*/
+uint64_t Entry::image_offset(uint32_t offset, bool skip)
+{
+  //  Without headers and junk the sectors are only the data
+  uint32_t sector_size = skip ? this->m_real_block_size : this->m_logical_block_size;
+  uint64_t start = this->location(this->m_real_block_size) + (skip ? SectionHeaderSize : 0);
 
-  //  Restore original position
-  dest.seekg(fpos, std::ios::beg);
-}
\ No newline at end of file
+  return start + static_cast<uint64_t>(offset / this->m_logical_block_size) * sector_size + offset % this->m_logical_block_size;
+}
@@ -3,7 +3,6 @@
 
 #include <memory>
 #include <vector>
-#include <fstream>
 #include <algorithm>
 
 #include "util.h"
@@ -45,19 +44,22 @@ public:
   static const uint8_t SectionHeaderSize = 0x18;
 
   Entry();
-  Entry(std::vector<uint8_t>& bytes, uint32_t r_blocksize, uint32_t l_blocksize);
+  Entry(util::ByteView bytes, uint32_t r_blocksize, uint32_t l_blocksize);
   ~Entry();
 
   bool is_directory();
-  static bool is_directory(std::vector<uint8_t>& entry);
-  static bool is_file(std::vector<uint8_t>& entry);
+  static bool is_directory(util::ByteView entry);
+  static bool is_file(util::ByteView entry);
   uint32_t location(uint32_t blocksize);
+  uint32_t sectors();
   uint32_t size();
   std::string name();
 
-  std::vector<uint8_t> get(std::fstream& source, bool junk = true);
-  void write(std::fstream& dest, std::vector<uint8_t> data, bool skip = true);
+  std::vector<uint8_t> get(util::ByteView image, bool junk = true);
+  uint64_t image_offset(uint32_t offset, bool skip = true);
 private:
+  uint64_t span(uint32_t offset, uint32_t count, bool skip);
+
   uint8_t m_size;
   uint8_t m_extended_size;
   uint32_t m_location;
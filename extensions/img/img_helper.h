@@ -5,11 +5,12 @@
 #ifndef _IMG_HELPER_H
 #define _IMG_HELPER_H
 
+#include "util.h"
 
 namespace IMGHelper
 {
 
-  template <typename T> inline T read(std::vector<uint8_t>& data, uint32_t offset)
+  template <typename T> inline T read(util::ByteView data, uint32_t offset)
   {
     static_assert(std::is_integral<T>::value, "Value must be an integral type.");
     T ret = 0;
@@ -22,7 +23,7 @@ namespace IMGHelper
     return ret;
   }
 
-  inline std::string read(std::vector<uint8_t>& data, uint32_t offset, size_t size)
+  inline std::string read(util::ByteView data, uint32_t offset, size_t size)
   {
     std::string ret(data.begin() + offset, data.begin() + offset + size);
     ret.erase(ret.find_last_not_of(" \n\r\t") + 1);
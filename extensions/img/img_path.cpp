@@ -13,7 +13,7 @@ Path::Path()
   @param bytes - The raw bytes read from an img or bin file from the global path table
   @param offset - Offset of the bytes to use to construct the class. Defaults to 0.
 */
-Path::Path(std::vector<uint8_t>& bytes, uint32_t offset)
+Path::Path(util::ByteView bytes, uint32_t offset)
 {
   //  Grab identifier length
   uint8_t size = bytes[offset];
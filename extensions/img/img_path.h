@@ -15,7 +15,7 @@ public:
   static const uint8_t SectionHeaderSize = 0x18;
 
   Path();
-  Path(std::vector<uint8_t>& bytes, uint32_t offset = 0);
+  Path(util::ByteView bytes, uint32_t offset = 0);
   Path(Path& obj);
   ~Path();
 
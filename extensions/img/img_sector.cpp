@@ -0,0 +1,188 @@
+#include "img_sector.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include "simd.h"
+
+namespace sector
+{
+  //  Reflected polynomial of the EDC, x^32 + x^31 + x^16 + x^15 + x^4 + x^3 + x + 1
+  struct EDCTable
+  {
+    uint32_t entries[0x100];
+  };
+
+  static constexpr EDCTable make_edc_table()
+  {
+    EDCTable table{};
+
+    for (uint32_t i = 0; i < 0x100; i++)
+    {
+      uint32_t edc = i;
+
+      for (uint32_t bit = 0; bit < 8; bit++)
+      {
+        edc = (edc >> 1) ^ (edc & 1 ? 0xD8018001 : 0);
+      }
+
+      table.entries[i] = edc;
+    }
+
+    return table;
+  }
+
+  static constexpr EDCTable edc_table = make_edc_table();
+
+  //  Inverse of multiplying by x + 1 in GF(2^8), which finishes the parity of a column
+  struct ECCTable
+  {
+    uint8_t divide[0x100];
+  };
+
+  static constexpr ECCTable make_ecc_table()
+  {
+    ECCTable table{};
+
+    for (uint32_t i = 0; i < 0x100; i++)
+    {
+      uint32_t doubled = (i << 1) ^ (i & 0x80 ? 0x11D : 0);
+      table.divide[i ^ doubled] = static_cast<uint8_t>(i);
+    }
+
+    return table;
+  }
+
+  static constexpr ECCTable ecc_table = make_ecc_table();
+
+  static const uint8_t Sync[12] = { 0x00, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0x00 };
+
+  uint32_t edc(const uint8_t* data, size_t size, uint32_t edc)
+  {
+    for (size_t i = 0; i < size; i++)
+    {
+      edc = (edc >> 8) ^ edc_table.entries[(edc ^ data[i]) & 0xFF];
+    }
+
+    return edc;
+  }
+
+  static inline uint8_t gf_double(uint8_t x)
+  {
+    return static_cast<uint8_t>((x << 1) ^ ((x & 0x80) ? 0x1D : 0));
+  }
+
+  /*
+    Computes one parity block. Column c of the block reads the bytes at
+    (c / 2) * column_step + c % 2 + n * row_step (wrapping around the
+    block) for every row n.
+
+    @param block - Start of the protected bytes, 0xC into the sector
+    @param columns - Amount of columns, half of the parity bytes
+    @param rows - Bytes in each column
+    @param column_step - Distance between pairs of columns
+    @param row_step - Distance between bytes of a column
+    @param parity - Where the 2 * columns bytes of parity go
+  */
+  static void parity_block(const uint8_t* block, uint32_t columns, uint32_t rows, uint32_t column_step, uint32_t row_step, uint8_t* parity)
+  {
+    uint32_t size = columns * rows;
+    uint8_t a[86] = {};
+    uint8_t b[86] = {};
+
+    //  P columns are consecutive bytes, so every row of the block is already a row of lanes
+    if (column_step == 2 && row_step == columns)
+    {
+      simd::parity(block, rows, columns, a, b);
+    }
+    else
+    {
+      //  Gather the columns into rows so every column is a lane, Q is the larger block
+      uint8_t lanes[52 * 43];
+
+      for (uint32_t column = 0; column < columns; column++)
+      {
+        uint32_t index = (column >> 1) * column_step + (column & 1);
+
+        for (uint32_t row = 0; row < rows; row++)
+        {
+          lanes[row * columns + column] = block[index];
+          index += row_step;
+
+          if (index >= size)
+          {
+            index -= size;
+          }
+        }
+      }
+
+      simd::parity(lanes, rows, columns, a, b);
+    }
+
+    for (uint32_t column = 0; column < columns; column++)
+    {
+      uint8_t first = ecc_table.divide[gf_double(a[column]) ^ b[column]];
+
+      parity[column] = first;
+      parity[column + columns] = first ^ b[column];
+    }
+  }
+
+  void ecc(uint8_t* sector, bool zero_address)
+  {
+    uint8_t address[4];
+
+    if (zero_address)
+    {
+      std::memcpy(address, sector + 0xC, 4);
+      std::memset(sector + 0xC, 0, 4);
+    }
+
+    parity_block(sector + 0xC, 86, 24, 2, 86, sector + 0x81C);
+    parity_block(sector + 0xC, 52, 43, 86, 88, sector + 0x8C8);
+
+    if (zero_address)
+    {
+      std::memcpy(sector + 0xC, address, 4);
+    }
+  }
+
+  static inline void write_edc(uint8_t* sector, uint32_t offset, uint32_t value)
+  {
+    sector[offset] = value & 0xFF;
+    sector[offset + 1] = (value >> 8) & 0xFF;
+    sector[offset + 2] = (value >> 16) & 0xFF;
+    sector[offset + 3] = (value >> 24) & 0xFF;
+  }
+
+  bool regenerate(uint8_t* sector)
+  {
+    if (!std::equal(Sync, Sync + sizeof(Sync), sector))
+    {
+      return false;
+    }
+
+    switch (sector[0xF])
+    {
+    case 1:
+      write_edc(sector, 0x810, edc(sector, 0x810));
+      std::memset(sector + 0x814, 0, 8);
+      ecc(sector, false);
+      return true;
+    case 2:
+      //  Form 2 is set in the submode byte of the subheader
+      if (sector[0x12] & 0x20)
+      {
+        write_edc(sector, 0x92C, edc(sector + 0x10, 0x91C));
+      }
+      else
+      {
+        write_edc(sector, 0x818, edc(sector + 0x10, 0x808));
+        ecc(sector, true);
+      }
+      return true;
+    default:
+      return false;
+    }
+  }
+}
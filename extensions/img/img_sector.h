@@ -0,0 +1,60 @@
+#ifndef _IMG_SECTOR_H
+#define _IMG_SECTOR_H
+
+/*
+  Error detection and correction of raw 0x930 byte CD sectors.
+
+  Every raw sector starts with a sync pattern and a header whose last byte
+  is the mode. The data is followed by an EDC (a CRC32 of the sector) and
+  for Mode 1 and Mode 2 Form 1 by P and Q parity (ECC) that lets drives
+  repair errors. Changing the data without updating these makes drives and
+  some emulators reject or "repair" the sector back.
+
+      Mode 1            Mode 2 Form 1       Mode 2 Form 2
+    0x000 Sync          0x000 Sync          0x000 Sync
+    0x00C Header        0x00C Header        0x00C Header
+    0x010 Data          0x010 Subheader     0x010 Subheader
+    0x810 EDC           0x018 Data          0x018 Data
+    0x814 Zero          0x818 EDC           0x92C EDC
+    0x81C ECC P         0x81C ECC P
+    0x8C8 ECC Q         0x8C8 ECC Q
+
+  Mode 2 leaves the header out of the ECC by treating it as zero.
+*/
+
+#include <cstddef>
+#include <cstdint>
+
+namespace sector
+{
+  static const uint32_t Size = 0x930;
+
+  /*
+    @param data - Bytes to check
+    @param size - Amount of bytes
+    @param edc - Result of the previous call when checking in parts
+
+    @return the EDC of the bytes.
+  */
+  uint32_t edc(const uint8_t* data, size_t size, uint32_t edc = 0);
+
+  /*
+    Computes the P and Q parity of a sector into it.
+
+    @param sector - A raw sector
+    @param zero_address - Treat the header as zero, for Mode 2
+  */
+  void ecc(uint8_t* sector, bool zero_address);
+
+  /*
+    Updates the EDC and ECC of a raw sector from its mode. Sectors without
+    the sync pattern or with an unknown mode are left alone.
+
+    @param sector - A raw sector of Size bytes
+
+    @return false if the sector was left alone.
+  */
+  bool regenerate(uint8_t* sector);
+}
+
+#endif
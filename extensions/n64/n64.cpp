@@ -1,5 +1,10 @@
 #include "n64.h"
 
+#include "formats.h"
+
+//  The first word of the header in big endian, byte swapped and little endian order
+static formats::Registrar format({ "N64", "", { ".z64", ".v64", ".n64" }, { { 0, 0x80371240 }, { 0, 0x37804012 }, { 0, 0x40123780 } }, formats::handler<N64Corruption>() });
+
 N64Corruption::N64Corruption()
 {
 
@@ -21,8 +26,9 @@ void N64Corruption::initialize(std::string filename, std::vector<std::string>& a
   rom = util::read_file(filename);
   convert_to_z64(rom);
 
-  header = std::make_unique<N64Header>(rom);
+  header = std::make_shared<N64Header>(rom);
   info = std::make_unique<CorruptionInfo>(args);
+  this->keep_original(info->patch());
 
   // If the rom is not valid then throw an exception
   if (!valid())
@@ -55,21 +61,59 @@ bool N64Corruption::valid()
   return true;
 }
 
+void N64Corruption::corrupt()
+{
+  corrupt_rom(N64Validator(rom));
+}
+
 bool N64Corruption::valid_byte(uint8_t byte, uint32_t location)
+{
+  return N64Validator(rom).valid_byte(byte, location);
+}
+
+/*
+  Primary opcodes that are not safe to modify, indexed by bits 31 to 21 of
+  the instruction (opcode and format).
+*/
+static constexpr bool is_protected_opcode(uint32_t index)
+{
+  uint32_t opcode = index >> 5;
+  uint32_t format = index & 0x1F;
+
+  return opcode == 0x01                                         //  *2 REGIMM, no acceptable instructions
+      || (opcode == 0x10 && (format == 0x08 || format >= 0x10)) //  *3 COP0 BC and TLB instructions
+      || (opcode == 0x11 && format == 0x08)                     //  *4 COP1 BC instructions
+      || opcode == 0x12;                                        //  *5 COP2 is undocumented, protect it to be safe
+}
+
+/*
+  SPECIAL functions that are not safe to modify:
+  SLL | SRL | SRA | SLLV | SRLV | SRAV | JR | JALR | SYSCALL | BREAK | SYNC
+*/
+static constexpr bool is_protected_special(uint32_t function)
+{
+  return function <= 0x0F;
+}
+
+static constexpr opcodes::BitTable<0x800> opcode_table = opcodes::make_bit_table<0x800>(is_protected_opcode);
+static constexpr opcodes::BitTable<0x40> special_table = opcodes::make_bit_table<0x40>(is_protected_special);
+
+bool N64Validator::protected_location(uint32_t location) const
 {
   //  If location is in the header don't do anything
   if (location < N64Header::Size)
   {
-    return false;
+    return true;
   }
 
-  //  Get instruction which is bound to a 4 byte alignment
-  uint32_t instruction = util::read<uint32_t>(ref(rom), location - (location % 4));
+  //  The whole instruction has to be inside of the rom
+  if (static_cast<uint64_t>(location - (location % 4)) + 4 > this->rom.size())
+  {
+    return true;
+  }
 
-  //  Get first opcode which is between bits 31 and 26 ( 6 bits total )
-  uint8_t opcode = (instruction >> 24) & 0xFC;
-  uint8_t high = opcode & 0x38;
-  uint8_t low = opcode & 0x07;
+  //  Get instruction which is bound to a 4 byte alignment, z64 roms are big endian
+  uint32_t instruction = util::read_big<uint32_t>(rom, location - (location % 4));
 
   /*
         31---------26---------------------------------------------------0
@@ -89,53 +133,14 @@ bool N64Corruption::valid_byte(uint8_t byte, uint32_t location)
          *3 = COP0                  *4 = COP1                   *5 = COP2
   */
 
-  if (opcode == 0x00)       // *1 SPECIAL
-  {
-    uint8_t function = instruction & 0x3F;
-    //  Block the following opcodes:
-    //  SLL | SRL | SRA | SLLV | SRLV | SRAV | JR | JALR | SYSCALL | BREAK | SYNC
-    if (function <= 0x0F)
-    {
-      return false;
-    }
-  }
-  else if (opcode == 0x01)  // *2 REGIMM
-  {
-    return false; // No acceptable instructions under REGIMM
-  }
-  else if (opcode == 0x10)  // *3 COP0
-  {
-    //  Format is 5 bits from 25 to 21 in the instruction
-    uint8_t format = instruction & 0x3E00000;
-    uint8_t fmthigh = format & 0x18;
-    uint8_t fmtlow = format & 0x07;
-
-    if (fmthigh == 1)       //  *1 BC Instruction
-    {
-      return false; // No valid BC instructions
-    }
-    else if (fmthigh == 2)  //  *2 TLB Instruction
-    {
-      return false; // No valid TLB instructions
-    }
-  }
-  else if (opcode == 0x11)  // *4 COP1
-  {
-    //  Format is 5 bits from 25 to 21 in the instruction
-    uint8_t format = instruction & 0x3E00000;
-
-    if (format == 8)
-    {
-      return false; // No valid BC instructions
-    }
-  }
-  else if (opcode == 0x12)  // *4 COP2
+  //  SPECIAL instructions are told apart by their function in bits 5 to 0
+  if ((instruction >> 26) == 0x00)
   {
-    //  No documentation on COP2 instructions from the resource I was given.
-    return false; // In the mean while, return false to be safe.
+    return special_table.test(instruction & 0x3F);
   }
 
-  return true;
+  //  Everything else by the opcode and the format in bits 25 to 21
+  return opcode_table.test(instruction >> 21);
 }
 
 void N64Corruption::save(std::string filename)
@@ -152,13 +157,11 @@ void N64Corruption::save(std::string filename)
   {
     if (info->save_file() != "")
     {
-      util::write_file(info->save_file(), rom);
-      this->save_name = info->save_file();
+      this->save_name = this->write_rom(info->save_file(), info->patch());
     }
     else
     {
-      util::write_file(filename, rom);
-      this->save_name = filename;
+      this->save_name = this->write_rom(filename, info->patch());
     }
   }
   catch (InvalidFileNameException e)
@@ -194,4 +197,21 @@ void N64Corruption::convert_to_z64(std::vector<uint8_t>& data)
       data[i + 3] = (temp >> 24) & 0xFF;
     }
   }
-}
\ No newline at end of file
+}
+
+/*
+  Makes a new corruption of this rom sharing its header and protections.
+
+  @param args - Arguments of the new corruption
+*/
+std::unique_ptr<Corruption> N64Corruption::variant(std::vector<std::string>& args)
+{
+  auto copy = std::make_unique<N64Corruption>();
+
+  copy->share(*this);
+  copy->header = this->header;
+  copy->info = std::make_unique<CorruptionInfo>(args);
+  copy->keep_original(copy->info->patch());
+
+  return copy;
+}
@@ -54,9 +54,29 @@
 #include <memory>
 
 #include "corrupt.h"
+#include "opcodes.h"
 
 #include "n64_header.h"
 
+/*
+  Protections for the MIPS instructions of N64 roms.
+*/
+class N64Validator : public engine::Validator<N64Validator>
+{
+public:
+  N64Validator(util::ByteView rom) : rom(rom) {};
+
+  inline bool valid_byte(uint8_t byte, uint32_t location) const
+  {
+    return !protected_location(location);
+  }
+
+  bool protected_location(uint32_t location) const;
+
+private:
+  util::ByteView rom;
+};
+
 class N64Corruption : public Corruption
 {
 public:
@@ -66,16 +86,19 @@ public:
   N64Corruption(std::string filename, std::vector<std::string>& args);
   ~N64Corruption();
 
+  virtual void corrupt();
   virtual void initialize(std::string filename, std::vector<std::string>& args);
   virtual bool valid();
   virtual bool valid_byte(uint8_t byte, uint32_t location);
   virtual void print_header();
   virtual void save(std::string filename);
 
+  virtual std::unique_ptr<Corruption> variant(std::vector<std::string>& args);
+
   void convert_to_z64(std::vector<uint8_t>& data);
 
 private:
-  std::unique_ptr<N64Header> header;
+  std::shared_ptr<N64Header> header;
 
 };
 
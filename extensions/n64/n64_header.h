@@ -32,9 +32,9 @@ public:
   static const uint32_t Size = 0x1000;
 
   N64Header();
-  N64Header(std::vector<uint8_t>& rom);
+  N64Header(util::ByteView rom);
 
-  void initialize(std::vector<uint8_t>& rom);
+  void initialize(util::ByteView rom);
 
   uint32_t domain();
   uint32_t clock_rate();
@@ -1,6 +1,11 @@
 #include "nds.h"
 
-NDSCorruption::NDSCorruption()
+#include "formats.h"
+
+//  Start of the Nintendo logo in the header
+static formats::Registrar format({ "NDS", "", { ".nds" }, { { 0xC0, 0x24FFAE51 } }, formats::handler<NDSCorruption>() });
+
+NDSCorruption::NDSCorruption() : m_save(false)
 {
 
 }
@@ -18,9 +23,10 @@ NDSCorruption::~NDSCorruption()
 void NDSCorruption::initialize(std::string filename, std::vector<std::string>& args)
 {
   rom = util::read_file(filename);
-  header = std::make_unique<NDSHeader>(rom);
+  header = std::make_shared<NDSHeader>(rom);
   info = std::make_unique<CorruptionInfo>(args);
-  filesystem = std::make_unique<NDSFileSystem>(rom, header);
+  this->keep_original(info->patch());
+  filesystem = std::make_shared<NDSFileSystem>(rom, header);
 
   m_save = false;
 
@@ -41,11 +47,12 @@ void NDSCorruption::corrupt()
   std::cout << "Rom size: " << std::hex << rom.size() << std::dec << std::endl;
 
 
-  //  For counting amount of corruptions
-  uint32_t corruptions = 0;
+  //  File offsets are fixed, so the whole rom is analyzed once before any
+  //  file is corrupted and each file only bounds the range of its run
+  this->protection->analyze_once(rom.size(), NDSValidator(rom));
 
-  //  Random number distribution over the byte value range
-  std::uniform_int_distribution<int> random(0x00, 0xFF);
+  //  For counting amount of corruptions
+  uint64_t corruptions = 0;
 
   for (auto& file : info->files())
   {
@@ -62,122 +69,24 @@ void NDSCorruption::corrupt()
       continue;
     }
 
-    for (uint32_t i = info->start() + entry.offset(); i < entry.offset() + entry.size() && i - entry.offset() < info->end(); i += info->step())
+    //  Offsets are relative to the start of the file
+    uint64_t file_end = static_cast<uint64_t>(entry.offset()) + entry.size();
+    uint64_t end = std::min<uint64_t>(file_end, static_cast<uint64_t>(entry.offset()) + std::min<uint64_t>(file_end, info->end()));
+
+    //  Swap writes value bytes past the last offset, which has to stay in the file
+    if (info->type() == CorruptionType::Swap)
     {
-      if (info->type() == CorruptionType::Shift)
-      {
-        //  If it's okay to put the other byte in this position then change it
-        if (i + info->value() < rom.size() && valid_byte(rom[i + info->value()], i))
-        {
-          corruptions++;
-          rom[i] = rom[i + info->value()];
-        }
-      }
-      else if (info->type() == CorruptionType::Swap)
-      {
-
-        if (i + info->value() < rom.size() &&
-          valid_byte(rom[i + info->value()], i) &&  //  If it's okay to put the other byte in this position
-          valid_byte(rom[i], i + info->value()))    //  And it's okay to put this byte in the other position
-        {
-          corruptions++;
-          uint8_t temp = rom[i + info->value()];
-          rom[i] = temp;
-          rom[i + info->value()] = temp;
-        }
-      }
-      else if (info->type() == CorruptionType::Add)
-      {
-        //  If the new byte value is valid then do the corruption
-        if (valid_byte(rom[i] + info->value(), i))
-        {
-          corruptions++;
-          rom[i] += info->value();
-        }
-      }
-      else if (info->type() == CorruptionType::Set)
-      {
-        //  If the set value can be placed here then do it
-        if (valid_byte(info->value(), i))
-        {
-          corruptions++;
-          rom[i] = info->value();
-        }
-      }
-      else if (info->type() == CorruptionType::Random)
-      {
-        bool corrupted = false;
-
-        //  Try up to 100 times to corrupt
-        for (uint32_t retry = 0; !corrupted && retry < 100; retry++)
-        {
-          uint8_t rand = random(this->random);
-          if (valid_byte(rand, i))
-          {
-            corruptions++;
-            rom[i] = rand;
-            corrupted = true;
-          }
-        }
-      }
-      else if (info->type() == CorruptionType::RotateLeft)
-      {
-        uint8_t rotate = util::rol<uint8_t>(rom[i], info->value());
-
-        if (valid_byte(rotate, i))
-        {
-          rom[i] = rotate;
-          corruptions++;
-        }
-      }
-      else if (info->type() == CorruptionType::RotateRight)
-      {
-        uint8_t rotate = util::ror<uint8_t>(rom[i], info->value());
-
-        if (valid_byte(rotate, i))
-        {
-          rom[i] = rotate;
-          corruptions++;
-        }
-      }
-      else if (info->type() == CorruptionType::LogicalAnd)
-      {
-        if (valid_byte(rom[i] & info->value(), i))
-        {
-          rom[i] &= info->value();
-          corruptions++;
-        }
-      }
-      else if (info->type() == CorruptionType::LogicalOr)
-      {
-        if (valid_byte(rom[i] | info->value(), i))
-        {
-          rom[i] |= info->value();
-          corruptions++;
-        }
-      }
-      else if (info->type() == CorruptionType::LogicalXor)
-      {
-        if (valid_byte(rom[i] ^ info->value(), i))
-        {
-          rom[i] ^= info->value();
-          corruptions++;
-        }
-      }
-      else if (info->type() == CorruptionType::LogicalComplement)
-      {
-        if (valid_byte(~rom[i], i))
-        {
-          rom[i] = ~rom[i];
-          corruptions++;
-        }
-      }
-      else
-      {
-        break;  //  No corruption selected, might as well quit.
-      }
+      end = std::min<uint64_t>(end, file_end - std::min<uint64_t>(file_end, info->value()));
     }
 
+    engine::Options options(info->type(),
+                            info->value(),
+                            info->start() + entry.offset(),
+                            end,
+                            info->step());
+
+    corruptions += engine::corrupt(rom, options, *this->protection, rng::derive(info->seed(), rng::hash(file)));
+
     //  Write the modified data back to the file
     //entry.write(rom, data);
   }
@@ -195,57 +104,22 @@ bool NDSCorruption::valid()
 
 bool NDSCorruption::valid_byte(uint8_t byte, uint32_t location)
 {
-  //  Entire instruction is at location of the nearest 4 byte boundary
-  uint32_t instruction = util::read<uint32_t>(ref(rom), location - (location % 4));
-
-  /*
-    Format for ARM9 instructions:
-
-    +-----------------------------------------------------+
-    |31  28|27      20|19               8|7        4|3   0|
-    |-----------------------------------------------------|
-    | COND | OPCODE 1 | PARAMETERS/OTHER | OPCODE 2 | RM  |
-    +-----------------------------------------------------+
-  */
-
-  uint8_t condition = (instruction & 0xF0000000) >> 24;
-  uint8_t opcode1   = (instruction & 0x0FF00000) >> 20;
-  uint8_t opcode2   = (instruction & 0x000000F0) >> 4;
-
-  //  When opcode1 is between 0x80 and 0xE0 it will be jumps or load/store
-  if (opcode1 >= 0x80 && opcode1 < 0xE0)
-  {
-    return false;
-  }
+  return NDSValidator(rom).valid_byte(byte, location);
+}
 
-  //  Every even opcode1 between 0x60 and 0x80 is a load/store
-  if (opcode1 >= 0x60 && opcode1 < 0x80 && opcode2 % 2 == 0)
+bool NDSValidator::protected_location(uint32_t location) const
+{
+  //  The whole instruction has to be inside of the rom
+  if (static_cast<uint64_t>(location - (location % 4)) + 4 > this->rom.size())
   {
-    return false;
+    return true;
   }
 
-  //  Opcode1 between 0x40 and 0x60 are all load/store
-  if (opcode1 >= 0x40 && opcode1 < 0x60)
-  {
-    return false;
-  }
+  //  Entire instruction is at location of the nearest 4 byte boundary
+  uint32_t instruction = util::read<uint32_t>(rom, location - (location % 4));
 
-  //  If opcode1 is between 0x00 and 0x20
-  if (opcode1 >= 0x00 && opcode1 < 0x20)
-  {
-    if ((opcode2 & 0x0B) == 0x0B)
-    {
-      //  All opcode2 that end with 0x0B are load/store
-      return false;
-    }
-    else if (opcode1 % 2 == 1 && ((opcode2 & 0x0D) == 0x0D || (opcode2 & 0x0F) == 0x0F))
-    {
-      //  All opcode2 that end with 0x0D or 0x0F and have an odd opcode1 are load/store
-      return false;
-    }
-  }
-  
-  return true;
+  //  Jumps and load/store instructions are protected
+  return opcodes::arm::is_protected_instruction(instruction);
 }
 
 void NDSCorruption::print_header()
@@ -273,13 +147,11 @@ void NDSCorruption::save(std::string filename)
   {
     if (info->save_file() != "")
     {
-      util::write_file(info->save_file(), rom);
-      this->save_name = info->save_file();
+      this->save_name = this->write_rom(info->save_file(), info->patch());
     }
     else
     {
-      util::write_file(filename, rom);
-      this->save_name = filename;
+      this->save_name = this->write_rom(filename, info->patch());
     }
   }
   catch (InvalidFileNameException e)
@@ -288,3 +160,21 @@ void NDSCorruption::save(std::string filename)
     exit(EXIT_FAILURE);
   }
 }
+
+/*
+  Makes a new corruption of this rom sharing its header and file system.
+
+  @param args - Arguments of the new corruption
+*/
+std::unique_ptr<Corruption> NDSCorruption::variant(std::vector<std::string>& args)
+{
+  auto copy = std::make_unique<NDSCorruption>();
+
+  copy->share(*this);
+  copy->header = this->header;
+  copy->filesystem = this->filesystem;
+  copy->info = std::make_unique<CorruptionInfo>(args);
+  copy->keep_original(copy->info->patch());
+
+  return copy;
+}
@@ -5,12 +5,32 @@
 #include <string>
 
 #include "corrupt.h"
+#include "opcodes.h"
 
 #include "nds_except.h"
 #include "nds_header.h"
 
 #include "nds_filesystem.h"
 
+/*
+  Protections for the ARM9 instructions of NDS roms.
+*/
+class NDSValidator : public engine::Validator<NDSValidator>
+{
+public:
+  NDSValidator(util::ByteView rom) : rom(rom) {};
+
+  inline bool valid_byte(uint8_t byte, uint32_t location) const
+  {
+    return !protected_location(location);
+  }
+
+  bool protected_location(uint32_t location) const;
+
+private:
+  util::ByteView rom;
+};
+
 class NDSCorruption : public Corruption
 {
 public:
@@ -25,9 +45,11 @@ public:
   virtual bool valid_byte(uint8_t byte, uint32_t location);
   virtual void print_header();
   virtual void save(std::string filename);
+
+  virtual std::unique_ptr<Corruption> variant(std::vector<std::string>& args);
 private:
-  std::unique_ptr<NDSHeader> header;
-  std::unique_ptr<NDSFileSystem> filesystem;
+  std::shared_ptr<NDSHeader> header;
+  std::shared_ptr<NDSFileSystem> filesystem;
 
   std::string m_original_file;
   std::string m_temp_file;
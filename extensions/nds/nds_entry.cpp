@@ -11,12 +11,12 @@ NDSEntry::~NDSEntry()
 
 }
 
-std::vector<uint8_t> NDSEntry::contents(std::vector<uint8_t>& rom)
+util::ByteView NDSEntry::contents(util::ByteView rom)
 {
-  return std::vector<uint8_t>(rom.begin() + this->offset(), rom.begin() + this->offset() + this->size());
+  return rom.sub(this->offset(), this->size());
 }
 
-void NDSEntry::write(std::vector<uint8_t>& rom, std::vector<uint8_t>& data)
+void NDSEntry::write(util::ByteView rom, util::ByteView data)
 {
   std::copy(rom.begin() + this->offset(), rom.begin() + this->offset() + this->size(), data.begin());
 }
\ No newline at end of file
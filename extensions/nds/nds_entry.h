@@ -6,6 +6,8 @@
 #include <memory>
 #include <iostream>
 
+#include "util.h"
+
 class NDSEntry
 {
 public:
@@ -13,8 +15,8 @@ public:
   NDSEntry(uint32_t offset, uint32_t size) : m_offset(offset), m_size(size) {};
   ~NDSEntry();
 
-  std::vector<uint8_t> contents(std::vector<uint8_t>& rom);
-  void write(std::vector<uint8_t>& rom, std::vector<uint8_t>& data);
+  util::ByteView contents(util::ByteView rom);
+  void write(util::ByteView rom, util::ByteView data);
 
   std::string name();
   uint32_t offset();
@@ -7,7 +7,7 @@ NDSFileSystem::NDSFileSystem()
 
 }
 
-NDSFileSystem::NDSFileSystem(std::vector<uint8_t>& rom, std::unique_ptr<NDSHeader>& header)
+NDSFileSystem::NDSFileSystem(util::ByteView rom, std::shared_ptr<NDSHeader>& header)
 {
   this->initialize(rom, header);
 }
@@ -17,11 +17,11 @@ NDSFileSystem::~NDSFileSystem()
 
 }
 
-void NDSFileSystem::initialize(std::vector<uint8_t>& rom, std::unique_ptr<NDSHeader>& header)
+void NDSFileSystem::initialize(util::ByteView rom, std::shared_ptr<NDSHeader>& header)
 {
   std::cout << "FNT Offset: " << std::hex << header->file_name_table() << std::dec << std::endl;
-  uint16_t dir_total = util::read<uint16_t>(ref(rom), header->file_name_table() + 6);
-  uint16_t first_id = util::read<uint16_t>(ref(rom), header->file_name_table() + 4);
+  uint16_t dir_total = util::read<uint16_t>(rom, header->file_name_table() + 6);
+  uint16_t first_id = util::read<uint16_t>(rom, header->file_name_table() + 4);
   std::cout << "Initializing NDS File System. " << dir_total << " directories found." << std::endl;
 
   std::vector<std::string> current_directory = { "." };
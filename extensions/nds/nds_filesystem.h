@@ -14,10 +14,10 @@ class NDSFileSystem
 {
 public:
   NDSFileSystem();
-  NDSFileSystem(std::vector<uint8_t>& rom, std::unique_ptr<NDSHeader>& header);
+  NDSFileSystem(util::ByteView rom, std::shared_ptr<NDSHeader>& header);
   ~NDSFileSystem();
 
-  void initialize(std::vector<uint8_t>& rom, std::unique_ptr<NDSHeader>& header);
+  void initialize(util::ByteView rom, std::shared_ptr<NDSHeader>& header);
 
   NDSEntry get(std::string file);
   std::string to_json();
@@ -38,7 +38,7 @@ inline NDSEntry NDSFileSystem::get(std::string file)
 class NDSMainTableEntry
 {
 public:
-  NDSMainTableEntry(std::vector<uint8_t>& data, uint32_t offset, int32_t prev_start_id = 0)
+  NDSMainTableEntry(util::ByteView data, uint32_t offset, int32_t prev_start_id = 0)
   {
     m_offset = util::read<uint32_t>(data, offset);
     m_start_id = util::read<uint16_t>(data, offset + 4);
@@ -5,7 +5,7 @@ NDSHeader::NDSHeader()
 
 }
 
-NDSHeader::NDSHeader(std::vector<uint8_t>& rom)
+NDSHeader::NDSHeader(util::ByteView rom)
 {
   this->initialize(rom);
 }
@@ -15,7 +15,7 @@ NDSHeader::~NDSHeader()
 
 }
 
-void NDSHeader::initialize(std::vector<uint8_t>& rom)
+void NDSHeader::initialize(util::ByteView rom)
 {
   //  Move the raw header into the structure
   this->header.resize(NDSHeader::Header_Size);
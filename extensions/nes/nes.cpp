@@ -1,5 +1,10 @@
 #include "nes.h"
 
+#include "formats.h"
+
+//  iNES header
+static formats::Registrar format({ "NES", "", { ".nes" }, { { 0, formats::fourcc("NES\x1A") } }, formats::handler<NESCorruption>() });
+
 NESCorruption::NESCorruption()
 {
 
@@ -20,6 +25,7 @@ void NESCorruption::initialize(std::string filename, std::vector<std::string>& a
   // Read the rom file
   rom = util::read_file(filename);
   info = std::make_unique<NESCorruptionInfo>(args);
+  this->keep_original(info->patch());
 
   // If the rom is not valid then throw an exception
   if (!valid())
@@ -62,120 +68,19 @@ void NESCorruption::corrupt()
 
 void NESCorruption::corrupt_prg()
 {
-  uint32_t corruptions = 0;
-  std::uniform_int_distribution<int> dist(0x00, 0xFF);
+  uint32_t end = this->chr_start > info->prg_step() ? this->chr_start - info->prg_step() : 0;
 
-  for (uint32_t i = this->prg_start + info->prg_start(); i < this->chr_start - info->prg_step() && i < info->prg_end(); i += info->prg_step())
-  {
-    if (info->prg_type() == CorruptionType::Shift)
-    {
-      if (valid_byte(this->rom[i + info->prg_value()], i))
-      {
-        corruptions++;
-        this->rom[i] = this->rom[i + info->prg_value()];
-      }
-    }
-    else if (info->prg_type() == CorruptionType::Swap)
-    {
-      if (valid_byte(this->rom[i + info->prg_value()], i) &&
-        valid_byte(this->rom[i], i + info->prg_value()))
-      {
-        corruptions++;
-        uint8_t temp = this->rom[i + info->prg_value()];
-        this->rom[i + info->prg_value()] = this->rom[i];
-        this->rom[i] = temp;
-      }
-    }
-    else if (info->prg_type() == CorruptionType::Add)
-    {
-      if (valid_byte(this->rom[i + info->prg_value()] + info->prg_value(), i))
-      {
-        corruptions++;
-        this->rom[i] += info->prg_value();
-      }
-    }
-    else if (info->prg_type() == CorruptionType::Set)
-    {
-      if (valid_byte(info->prg_value(), i))
-      {
-        corruptions++;
-        this->rom[i] = info->prg_value();
-      }
-    }
-    else if (info->prg_type() == CorruptionType::Random)
-    {
-      bool corrupted = false;
+  engine::Options options(info->prg_type(),
+                          info->prg_value(),
+                          this->prg_start + info->prg_start(),
+                          std::min(end, info->prg_end()),
+                          info->prg_step());
 
-      //  Try up to 100 times to corrupt
-      for (uint32_t retry = 0; !corrupted && retry < 100; retry++)
-      {
-        uint8_t rand = dist(this->random);
-
-        if (valid_byte(rand, i))
-        {
-          corruptions++;
-          this->rom[i] = rand;
-          corrupted = true;
-        }
-      }
-    }
-    else if (info->prg_type() == CorruptionType::RotateLeft)
-    {
-      uint8_t rotate = util::rol<uint8_t>(this->rom[i], info->prg_value());
+  //  Protections only depend on the original rom so they are analyzed once
+  this->protection->analyze_once(rom.size(), NESValidator(rom, chr_start), this->prg_start);
 
-      if (valid_byte(rotate, i))
-      {
-        this->rom[i] = rotate;
-        corruptions++;
-      }
-    }
-    else if (info->prg_type() == CorruptionType::RotateRight)
-    {
-      uint8_t rotate = util::ror<uint8_t>(this->rom[i], info->prg_value());
+  uint64_t corruptions = engine::corrupt(this->rom, options, *this->protection, info->seed());
 
-      if (valid_byte(rotate, i))
-      {
-        this->rom[i] = rotate;
-        corruptions++;
-      }
-    }
-    else if (info->prg_type() == CorruptionType::LogicalAnd)
-    {
-      if (valid_byte(this->rom[i] & info->prg_value(), i))
-      {
-        this->rom[i] &= info->prg_value();
-        corruptions++;
-      }
-    }
-    else if (info->prg_type() == CorruptionType::LogicalOr)
-    {
-      if (valid_byte(this->rom[i] | info->prg_value(), i))
-      {
-        this->rom[i] |= info->prg_value();
-        corruptions++;
-      }
-    }
-    else if (info->prg_type() == CorruptionType::LogicalXor)
-    {
-      if (valid_byte(this->rom[i] ^ info->prg_value(), i))
-      {
-        this->rom[i] ^= info->prg_value();
-        corruptions++;
-      }
-    }
-    else if (info->prg_type() == CorruptionType::LogicalComplement)
-    {
-      if (valid_byte(~this->rom[i], i))
-      {
-        this->rom[i] = ~this->rom[i];
-        corruptions++;
-      }
-    }
-    else
-    {
-      break;  //  No corruption selected, might as well quit.
-    }
-  }
   std::cout << "Replaced a total of " << corruptions << " bytes in PRG-ROM." << std::endl;
 }
 
@@ -190,7 +95,10 @@ void NESCorruption::corrupt_chr()
   //debug::cout << "CHR Type: " << info->chr_type() << std::endl;
 
   uint32_t corruptions = 0;
-  std::uniform_int_distribution<int> dist(0x00, 0xFF);
+
+  //  PRG-ROM uses the seed itself, which keys its chunks by their index, so
+  //  CHR-ROM draws from a seed derived for it instead
+  rng::Counter random(rng::derive(info->seed(), rng::hash("CHR-ROM")), 0);
 
   uint32_t chr_end = info->chr_end();
 
@@ -241,7 +149,7 @@ void NESCorruption::corrupt_chr()
       corruptions++;
       for (uint32_t index = i; index < rom.size() && index < i + 8; index++)
       {
-        this->rom[index] = dist(this->random);
+        this->rom[index] = random.byte();
       }
     }
     else if (info->chr_type() == CorruptionType::RotateLeft)
@@ -313,41 +221,65 @@ void NESCorruption::corrupt_chr()
 */
 bool NESCorruption::valid_byte(uint8_t byte, uint32_t location)
 {
-  //  If the location refers to CHR-ROM then it doesn't matter what the byte is
-  if (location >= this->chr_start)
-  {
-    return true;
-  }
+  return NESValidator(rom, chr_start).valid_byte(byte, location);
+}
 
-  //  Vector of invalid byte values to include in PRG-ROM
-  static std::vector<uint8_t> invalid({ 
-    0x00, 0x02, 0x08, 0x12, 0x22, 0x28, 0x32, 0x42, 0x48,
-    0x52, 0x62, 0x68, 0x72, 0x78, 0x92, 0xB2, 0xD2, 0xF2 
-  });
+//  6502 opcodes that need protecting and their length including the opcode byte
+static constexpr opcodes::Opcode opcode_list[] = {
+  //  Stack opcodes and SEI
+  { 0x48, opcodes::Stack, 1 }, { 0x08, opcodes::Stack, 1 }, { 0x68, opcodes::Stack, 1 }, { 0x28, opcodes::Stack, 1 },
+  { 0x78, opcodes::Stack, 1 },
 
-  //  Byte immediately falls within the invalid byte range
-  if (std::find(invalid.begin(), invalid.end(), byte) != invalid.end())
-  {
-    return false;
-  }
+  //  RTI, RTS and BRK
+  { 0x40, opcodes::Return, 1 }, { 0x60, opcodes::Return, 1 }, { 0x00, opcodes::Return, 1 },
 
-  //  Vector of invalid bytes to have before the given insertion
-  static std::vector<uint8_t> protect({
-    0x48, 0x08, 0x68, 0x28, 0x78, 0x40, 0x60, 0x00, // Invalid for rom[location    ]
-    0x90, 0xB0, 0xF0, 0x30, 0xD0, 0x10, 0x50, 0x70, // Invalid for rom[location - 1]
-    0x4C, 0x6C, 0x20                                // Invalid for rom[location - 2]
-  });
-
-  //  If any invalid prefix bytes are found then it is not valid
-  if (std::find(protect.begin()     , protect.end(), this->rom[location    ]) != protect.end() ||
-      std::find(protect.begin() +  8, protect.end(), this->rom[location - 1]) != protect.end() ||
-      std::find(protect.begin() + 16, protect.end(), this->rom[location - 2]) != protect.end())
+  //  Branches
+  { 0x90, opcodes::Branch, 2 }, { 0xB0, opcodes::Branch, 2 }, { 0xF0, opcodes::Branch, 2 }, { 0x30, opcodes::Branch, 2 },
+  { 0xD0, opcodes::Branch, 2 }, { 0x10, opcodes::Branch, 2 }, { 0x50, opcodes::Branch, 2 }, { 0x70, opcodes::Branch, 2 },
+
+  //  JMP, JMP (indirect) and JSR
+  { 0x4C, opcodes::Branch, 3 }, { 0x6C, opcodes::Branch, 3 }, { 0x20, opcodes::Branch, 3 },
+
+  //  Invalid byte values to include in PRG-ROM
+  { 0x00, opcodes::Forbidden, 1 }, { 0x02, opcodes::Forbidden, 1 }, { 0x08, opcodes::Forbidden, 1 },
+  { 0x12, opcodes::Forbidden, 1 }, { 0x22, opcodes::Forbidden, 1 }, { 0x28, opcodes::Forbidden, 1 },
+  { 0x32, opcodes::Forbidden, 1 }, { 0x42, opcodes::Forbidden, 1 }, { 0x48, opcodes::Forbidden, 1 },
+  { 0x52, opcodes::Forbidden, 1 }, { 0x62, opcodes::Forbidden, 1 }, { 0x68, opcodes::Forbidden, 1 },
+  { 0x72, opcodes::Forbidden, 1 }, { 0x78, opcodes::Forbidden, 1 }, { 0x92, opcodes::Forbidden, 1 },
+  { 0xB2, opcodes::Forbidden, 1 }, { 0xD2, opcodes::Forbidden, 1 }, { 0xF2, opcodes::Forbidden, 1 }
+};
+
+static constexpr opcodes::Table opcode_table = opcodes::make_table(opcode_list);
+
+/*
+  Determines whether a byte value can be written into PRG-ROM.
+
+  @param byte - The byte that needs to be checked
+
+  @return true if the byte is not a stack, interrupt or halting opcode.
+*/
+bool NESValidator::valid_value(uint8_t byte)
+{
+  return !opcode_table.is(byte, opcodes::Forbidden);
+}
+
+/*
+  Determines whether a location in PRG-ROM is part of a stack or branch
+  instruction. CHR-ROM is never protected.
+
+  @param location - The offset in the rom
+
+  @return true if nothing may be written at @location.
+*/
+bool NESValidator::protected_location(uint32_t location) const
+{
+  //  If the location refers to CHR-ROM then it doesn't matter what the byte is
+  if (location >= this->chr_start)
   {
     return false;
   }
 
-  //  No false condition found
-  return true;
+  return opcode_table.covers(&this->rom[0], location, opcodes::Stack | opcodes::Return | opcodes::Branch);
 }
 
 /*
@@ -422,13 +354,11 @@ void NESCorruption::save(std::string filename)
   {
     if (info->save_file() != "")
     {
-      util::write_file(info->save_file(), rom);
-      this->save_name = info->save_file();
+      this->save_name = this->write_rom(info->save_file(), info->patch());
     }
     else
     {
-      util::write_file(filename, rom);
-      this->save_name = filename;
+      this->save_name = this->write_rom(filename, info->patch());
     }
   }
   catch (InvalidFileNameException e)
@@ -436,4 +366,25 @@ void NESCorruption::save(std::string filename)
     std::cout << e.what() << std::endl;
     exit(EXIT_FAILURE);
   }
-}
\ No newline at end of file
+}
+
+/*
+  Makes a new corruption of this rom sharing its layout and protections.
+
+  @param args - Arguments of the new corruption
+*/
+std::unique_ptr<Corruption> NESCorruption::variant(std::vector<std::string>& args)
+{
+  auto copy = std::make_unique<NESCorruption>();
+
+  copy->share(*this);
+  copy->prg_rom = this->prg_rom;
+  copy->chr_rom = this->chr_rom;
+  copy->chr = this->chr;
+  copy->prg_start = this->prg_start;
+  copy->chr_start = this->chr_start;
+  copy->info = std::make_unique<NESCorruptionInfo>(args);
+  copy->keep_original(copy->info->patch());
+
+  return copy;
+}
@@ -30,6 +30,7 @@
 
 */
 #include "corrupt.h"
+#include "opcodes.h"
 #include "nes_except.h"
 #include "nescorruptioninfo.h"
 
@@ -41,6 +42,34 @@
 #include <limits>
 
 
+/*
+  Opcode protections for PRG-ROM. CHR-ROM has no protections.
+*/
+class NESValidator : public engine::Validator<NESValidator>
+{
+public:
+  NESValidator(util::ByteView rom, uint32_t chr_start) : rom(rom), chr_start(chr_start) {};
+
+  inline bool valid_byte(uint8_t byte, uint32_t location) const
+  {
+    //  CHR-ROM takes any value
+    return location >= this->chr_start || (valid_value(byte) && !protected_location(location));
+  }
+
+  //  Opcode values are only restricted in PRG-ROM
+  inline uint32_t values_end() const
+  {
+    return this->chr_start;
+  }
+
+  bool protected_location(uint32_t location) const;
+  static bool valid_value(uint8_t byte);
+
+private:
+  util::ByteView rom;
+  uint32_t chr_start;
+};
+
 class NESCorruption : public Corruption
 {
 public:
@@ -55,6 +84,8 @@ public:
   virtual bool valid_byte(uint8_t byte, uint32_t location);
   virtual void save(std::string filename);
 
+  virtual std::unique_ptr<Corruption> variant(std::vector<std::string>& args);
+
   void corrupt_prg();
   void corrupt_chr();
 private:
@@ -235,6 +235,14 @@ NESCorruptionInfo::NESCorruptionInfo(std::vector<std::string>& args)
     {
       m_chr_end = util::to_int32(args[++i]);
     }
+    else if (arg == "--seed")
+    {
+      m_seed = util::to_int64(args[++i]);
+    }
+    else if (arg == "--patch")
+    {
+      m_patch = patch::format(args[++i]);
+    }
     else if (arg == "-o" || arg == "--out")
     {
       m_outfile = args[++i];
@@ -4,13 +4,13 @@ namespace bck
 {
   namespace detail
   {
-    SubHeader::SubHeader(std::vector<uint8_t>& data, uint32_t offset)
+    SubHeader::SubHeader(util::ByteView data, uint32_t offset)
     {
       m_magic = util::read(data, offset, 4);
       m_size = util::read_big<uint32_t>(data, offset + 4);
     }
 
-    Header::Header(std::vector<uint8_t>& data, uint32_t offset)
+    Header::Header(util::ByteView data, uint32_t offset)
     {
       m_magic = util::read(data, offset, 8);
       m_size = util::read_big<uint32_t>(data, offset + 8);
@@ -18,16 +18,12 @@ namespace bck
     }
   }
 
-  void BCKFile::corrupt(std::vector<uint8_t>& data, std::vector<std::string>& args)
+  void BCKFile::corrupt(util::ByteView data, std::vector<std::string>& args, uint64_t stream)
   {
     //debug::cout << "Starting to corrupt BCK" << std::endl;
     auto info = std::make_unique<CorruptionInfo>(args);
     auto header = std::make_unique<detail::Header>(data);
 
-    std::vector<uint8_t> subdata(data.begin() + header->size(), data.end());
-
-    NintendoFile::corrupt(subdata, args);
-
-    std::copy(subdata.begin(), subdata.end(), data.begin() + header->size());
+    NintendoFile::corrupt(data.sub(header->size()), args, stream);
   }
 }
\ No newline at end of file
@@ -10,7 +10,7 @@ namespace bck
     struct SubHeader
     {
       SubHeader() : m_magic(""), m_size(0) { };
-      SubHeader(std::vector<uint8_t>& data, uint32_t offset = 0);
+      SubHeader(util::ByteView data, uint32_t offset = 0);
     private:
       std::string m_magic;
       uint32_t m_size;
@@ -18,7 +18,7 @@ namespace bck
 
     struct Header
     {
-      Header(std::vector<uint8_t>& data, uint32_t offset = 0);
+      Header(util::ByteView data, uint32_t offset = 0);
       inline uint32_t size()
       {
         //  This is from looking at 3 random BCK files in Super Mario Sunshine.
@@ -35,10 +35,10 @@ namespace bck
   class BCKFile
   {
   public:
-    //BCKFile(std::vector<uint8_t>& data, std::vector<std::string>& args);
-    static void corrupt(std::vector<uint8_t>& data, std::vector<std::string>& args);
+    //BCKFile(util::ByteView data, std::vector<std::string>& args);
+    static void corrupt(util::ByteView data, std::vector<std::string>& args, uint64_t stream = 0);
 
-    static inline bool match(std::vector<uint8_t>& data)
+    static inline bool match(util::ByteView data)
     {
       return util::read(data, 0, 8) == "J3D1bck1" || util::read(data, 0, 8) == "J3D1btk1";
     }
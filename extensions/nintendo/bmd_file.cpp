@@ -4,7 +4,7 @@ namespace bmd
 {
   namespace detail
   {
-    INFHeader::INFHeader(std::vector<uint8_t>& data, uint32_t offset)
+    INFHeader::INFHeader(util::ByteView data, uint32_t offset)
     {
       m_magic = util::read(data, offset + INFHeader::Offset::Magic, 4);
       m_size = util::read_big<uint32_t>(data, offset + INFHeader::Offset::Size);
@@ -17,7 +17,7 @@ namespace bmd
       m_header_offset = offset;
     }
 
-    VTXHeader::VTXHeader(std::vector<uint8_t>& data, uint32_t offset)
+    VTXHeader::VTXHeader(util::ByteView data, uint32_t offset)
     {
       m_magic = util::read(data, offset + VTXHeader::Offset::Magic, 4);
       m_size = util::read_big<uint32_t>(data, offset + VTXHeader::Offset::Size);
@@ -32,7 +32,7 @@ namespace bmd
       m_header_offset = offset;
     }
 
-    EVPHeader::EVPHeader(std::vector<uint8_t>& data, uint32_t offset)
+    EVPHeader::EVPHeader(util::ByteView data, uint32_t offset)
     {
       m_magic = util::read(data, offset + EVPHeader::Offset::Magic, 4);
       m_size = util::read_big<uint32_t>(data, offset + EVPHeader::Offset::Size);
@@ -48,7 +48,7 @@ namespace bmd
       m_header_offset = offset;
     }
 
-    DRWHeader::DRWHeader(std::vector<uint8_t>& data, uint32_t offset)
+    DRWHeader::DRWHeader(util::ByteView data, uint32_t offset)
     {
       m_magic = util::read(data, offset + DRWHeader::Offset::Magic, 4);
       m_size = util::read_big<uint32_t>(data, offset + DRWHeader::Offset::Size);
@@ -60,7 +60,7 @@ namespace bmd
       m_header_offset = offset;
     }
 
-    JNTHeader::JNTHeader(std::vector<uint8_t>& data, uint32_t offset)
+    JNTHeader::JNTHeader(util::ByteView data, uint32_t offset)
     {
       m_magic = util::read(data, offset + JNTHeader::Offset::Magic, 4);
       m_size = util::read_big<uint32_t>(data, offset + JNTHeader::Offset::Size);
@@ -73,7 +73,7 @@ namespace bmd
       m_header_offset = offset;
     }
 
-    SHPHeader::SHPHeader(std::vector<uint8_t>& data, uint32_t offset)
+    SHPHeader::SHPHeader(util::ByteView data, uint32_t offset)
     {
       m_magic = util::read(data, offset + SHPHeader::Offset::Magic, 4);
       m_size = util::read_big<uint32_t>(data, offset + SHPHeader::Offset::Size);
@@ -91,7 +91,7 @@ namespace bmd
       m_header_offset = offset;
     }
 
-    MATHeader::MATHeader(std::vector<uint8_t>& data, uint32_t offset)
+    MATHeader::MATHeader(util::ByteView data, uint32_t offset)
     {
       m_magic = util::read(data, offset + MATHeader::Offset::Magic, 4);
       m_size = util::read_big<uint32_t>(data, offset + MATHeader::Offset::Size);
@@ -114,7 +114,7 @@ namespace bmd
       m_header_offset = offset;
     }
 
-    TEXHeader::TEXHeader(std::vector<uint8_t>& data, uint32_t offset)
+    TEXHeader::TEXHeader(util::ByteView data, uint32_t offset)
     {
       m_magic = util::read(data, offset + TEXHeader::Offset::Magic, 4);
       m_size = util::read_big<uint32_t>(data, offset + TEXHeader::Offset::Size);
@@ -131,7 +131,7 @@ namespace bmd
       m_header_offset = offset;
     }
 
-    Header::Header(std::vector<uint8_t>& data, uint32_t offset)
+    Header::Header(util::ByteView data, uint32_t offset)
     {
       m_magic = util::read(data, offset + Header::Offset::Magic, 8);
       m_size = util::read<uint32_t>(data, offset + Header::Offset::Size);
@@ -162,7 +162,7 @@ namespace bmd
       m_tex = std::make_unique<TEXHeader>(data, offset);
     }
 
-    BMTHeader::BMTHeader(std::vector<uint8_t>& data, uint32_t offset)
+    BMTHeader::BMTHeader(util::ByteView data, uint32_t offset)
     {
       m_magic = util::read(data, offset + BMTHeader::Offset::Magic, 8);
       m_size = util::read<uint32_t>(data, offset + BMTHeader::Offset::Size);
@@ -173,50 +173,25 @@ namespace bmd
     }
   }
 
-  void BMDFile::corrupt(std::vector<uint8_t>& data, std::vector<std::string>& args)
+  void BMDFile::corrupt(util::ByteView data, std::vector<std::string>& args, uint64_t stream)
   {
     auto header = std::make_unique<detail::Header>(data);
 
-    //  Get the sections into their own vectors
-    std::vector<uint8_t> inf(data.begin() + header->inf_begin(), data.begin() + header->inf_end());
-    NintendoFile::corrupt(inf, args);
-    std::copy(inf.begin(), inf.end(), data.begin() + header->inf_begin());
-
-    std::vector<uint8_t> vtx(data.begin() + header->vtx_begin(), data.begin() + header->vtx_end());
-    NintendoFile::corrupt(vtx, args);
-    std::copy(vtx.begin(), vtx.end(), data.begin() + header->vtx_begin());
-
-    std::vector<uint8_t> evp(data.begin() + header->evp_begin(), data.begin() + header->evp_end());
-    NintendoFile::corrupt(evp, args);
-    std::copy(evp.begin(), evp.end(), data.begin() + header->evp_begin());
-
-    std::vector<uint8_t> drw(data.begin() + header->drw_begin(), data.begin() + header->drw_end());
-    NintendoFile::corrupt(drw, args);
-    std::copy(drw.begin(), drw.end(), data.begin() + header->drw_begin());
-
-    std::vector<uint8_t> jnt(data.begin() + header->jnt_begin(), data.begin() + header->jnt_end());
-    NintendoFile::corrupt(jnt, args);
-    std::copy(jnt.begin(), jnt.end(), data.begin() + header->jnt_begin());
-
-    std::vector<uint8_t> shp(data.begin() + header->shp_begin(), data.begin() + header->shp_end());
-    NintendoFile::corrupt(shp, args);
-    std::copy(shp.begin(), shp.end(), data.begin() + header->shp_begin());
-
-    std::vector<uint8_t> mat(data.begin() + header->mat_begin(), data.begin() + header->mat_end());
-    NintendoFile::corrupt(mat, args);
-    std::copy(mat.begin(), mat.end(), data.begin() + header->mat_begin());
-
-    std::vector<uint8_t> tex(data.begin() + header->tex_begin(), data.begin() + header->tex_end());
-    NintendoFile::corrupt(tex, args);
-    std::copy(tex.begin(), tex.end(), data.begin() + header->tex_begin());
+    //  Each section is corrupted where it is with its own random stream
+    NintendoFile::corrupt(data.sub(header->inf_begin(), header->inf_end() - header->inf_begin()), args, rng::derive(stream, 0));
+    NintendoFile::corrupt(data.sub(header->vtx_begin(), header->vtx_end() - header->vtx_begin()), args, rng::derive(stream, 1));
+    NintendoFile::corrupt(data.sub(header->evp_begin(), header->evp_end() - header->evp_begin()), args, rng::derive(stream, 2));
+    NintendoFile::corrupt(data.sub(header->drw_begin(), header->drw_end() - header->drw_begin()), args, rng::derive(stream, 3));
+    NintendoFile::corrupt(data.sub(header->jnt_begin(), header->jnt_end() - header->jnt_begin()), args, rng::derive(stream, 4));
+    NintendoFile::corrupt(data.sub(header->shp_begin(), header->shp_end() - header->shp_begin()), args, rng::derive(stream, 5));
+    NintendoFile::corrupt(data.sub(header->mat_begin(), header->mat_end() - header->mat_begin()), args, rng::derive(stream, 6));
+    NintendoFile::corrupt(data.sub(header->tex_begin(), header->tex_end() - header->tex_begin()), args, rng::derive(stream, 7));
   }
 
-  void BMTFile::corrupt(std::vector<uint8_t>& data, std::vector<std::string>& args)
+  void BMTFile::corrupt(util::ByteView data, std::vector<std::string>& args, uint64_t stream)
   {
     auto header = std::make_unique<detail::BMTHeader>(data, 0);
 
-    std::vector<uint8_t> mat(data.begin() + header->mat_begin(), data.begin() + header->mat_end());
-    NintendoFile::corrupt(mat, args);
-    std::copy(mat.begin(), mat.end(), data.begin() + header->mat_begin());
+    NintendoFile::corrupt(data.sub(header->mat_begin(), header->mat_end() - header->mat_begin()), args, stream);
   }
 }
\ No newline at end of file
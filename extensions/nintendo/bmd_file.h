@@ -9,7 +9,7 @@ namespace bmd
   {
     struct INFHeader
     {
-      INFHeader(std::vector<uint8_t>& data, uint32_t offset = 0);
+      INFHeader(util::ByteView data, uint32_t offset = 0);
 
       inline uint32_t size()
       {
@@ -58,7 +58,7 @@ namespace bmd
 
     struct VTXHeader
     {
-      VTXHeader(std::vector<uint8_t>& data, uint32_t offset = 0);
+      VTXHeader(util::ByteView data, uint32_t offset = 0);
 
       inline uint32_t size()
       {
@@ -100,7 +100,7 @@ namespace bmd
 
     struct EVPHeader
     {
-      EVPHeader(std::vector<uint8_t>& data, uint32_t offset = 0);
+      EVPHeader(util::ByteView data, uint32_t offset = 0);
 
       inline uint32_t size()
       {
@@ -144,7 +144,7 @@ namespace bmd
 
     struct DRWHeader
     {
-      DRWHeader(std::vector<uint8_t>& data, uint32_t offset = 0);
+      DRWHeader(util::ByteView data, uint32_t offset = 0);
 
       inline uint32_t size()
       {
@@ -188,7 +188,7 @@ namespace bmd
 
     struct JNTHeader
     {
-      JNTHeader(std::vector<uint8_t>& data, uint32_t offset = 0);
+      JNTHeader(util::ByteView data, uint32_t offset = 0);
 
       inline uint32_t size()
       {
@@ -236,7 +236,7 @@ namespace bmd
 
     struct SHPHeader
     {
-      SHPHeader(std::vector<uint8_t>& data, uint32_t offset = 0);
+      SHPHeader(util::ByteView data, uint32_t offset = 0);
 
       inline uint32_t size()
       {
@@ -293,7 +293,7 @@ namespace bmd
 
     struct MATHeader
     {
-      MATHeader(std::vector<uint8_t>& data, uint32_t offset = 0);
+      MATHeader(util::ByteView data, uint32_t offset = 0);
 
       inline uint32_t size()
       {
@@ -337,7 +337,7 @@ namespace bmd
 
     struct TEXHeader
     {
-      TEXHeader(std::vector<uint8_t>& data, uint32_t offset = 0);
+      TEXHeader(util::ByteView data, uint32_t offset = 0);
 
       inline uint32_t size()
       {
@@ -383,7 +383,7 @@ namespace bmd
 
     struct Header
     {
-      Header(std::vector<uint8_t>& data, uint32_t offset = 0);
+      Header(util::ByteView data, uint32_t offset = 0);
 
       inline uint32_t size()
       {
@@ -491,7 +491,7 @@ namespace bmd
 
     struct BMTHeader
     {
-      BMTHeader(std::vector<uint8_t>& data, uint32_t offset = 0);
+      BMTHeader(util::ByteView data, uint32_t offset = 0);
 
       inline uint32_t size()
       {
@@ -524,9 +524,9 @@ namespace bmd
   class BMDFile
   {
   public:
-    static void corrupt(std::vector<uint8_t>& data, std::vector<std::string>& args);
+    static void corrupt(util::ByteView data, std::vector<std::string>& args, uint64_t stream = 0);
 
-    static inline bool match(std::vector<uint8_t>& data)
+    static inline bool match(util::ByteView data)
     {
       return util::read(data, 0, 8) == "J3D2bmt3";
     }
@@ -536,9 +536,9 @@ namespace bmd
   class BMTFile
   {
   public:
-    static void corrupt(std::vector<uint8_t>& data, std::vector<std::string>& args);
+    static void corrupt(util::ByteView data, std::vector<std::string>& args, uint64_t stream = 0);
 
-    static inline bool match(std::vector<uint8_t>& data)
+    static inline bool match(util::ByteView data)
     {
       return util::read(data, 0, 8) == "J3D2bmd3";
     }
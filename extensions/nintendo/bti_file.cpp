@@ -4,7 +4,7 @@ namespace bti
 {
   namespace detail
   {
-    Header::Header(std::vector<uint8_t>& data, uint32_t offset)
+    Header::Header(util::ByteView data, uint32_t offset)
     {
       m_format = util::read_big<uint8_t>(data, offset + Header::Offset::Format);
       m_unknown1 = util::read_big<uint8_t>(data, offset + Header::Offset::Unknown1);
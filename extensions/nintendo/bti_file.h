@@ -9,7 +9,7 @@ namespace bti
   {
     struct Header
     {
-      Header(std::vector<uint8_t>& data, uint32_t offset = 0);
+      Header(util::ByteView data, uint32_t offset = 0);
     private:
       uint8_t m_format;
       uint8_t m_unknown1;
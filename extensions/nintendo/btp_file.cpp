@@ -2,11 +2,9 @@
 
 namespace btp
 {
-  void BTPFile::corrupt(std::vector<uint8_t>& data, std::vector<std::string>& args)
+  void BTPFile::corrupt(util::ByteView data, std::vector<std::string>& args, uint64_t stream)
   {
     //  As far as I'm aware, you only need to skip the header which is always 0x20 bytes.
-    std::vector<uint8_t> subdata(data.begin() + 0x20, data.end());
-    NintendoFile::corrupt(subdata, args);
-    std::copy(subdata.begin(), subdata.end(), data.begin() + 0x20);
+    NintendoFile::corrupt(data.sub(0x20), args, stream);
   }
 }
\ No newline at end of file
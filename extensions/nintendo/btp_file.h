@@ -18,9 +18,9 @@ namespace btp
   class BTPFile
   {
   public:
-    static void corrupt(std::vector<uint8_t>& data, std::vector<std::string>& args);
+    static void corrupt(util::ByteView data, std::vector<std::string>& args, uint64_t stream = 0);
 
-    static inline bool match(std::vector<uint8_t>& data)
+    static inline bool match(util::ByteView data)
     {
       return util::read(data, 0, 8) == "J3D1btp1";
     }
@@ -1,5 +1,8 @@
 #include "nintendo.h"
 
+#include <algorithm>
+
+#include "formats.h"
 #include "timer.h"
 
 using namespace rarc;
@@ -8,103 +11,95 @@ using namespace bmd;
 using namespace btp;
 using namespace u8;
 
+//  GameCube and Wii files, compressed or not
+static formats::Registrar format({
+  "Nintendo", "--nintendo",
+  { ".arc", ".rarc", ".szs", ".szp", ".bmd", ".bdl", ".bmt", ".bck", ".btk", ".btp" },
+  {
+    { 0, formats::fourcc("RARC") }, { 0, formats::fourcc("J3D1") }, { 0, formats::fourcc("J3D2") },
+    { 0, formats::fourcc("Yaz0") }, { 0, formats::fourcc("Yay0") }, { 0, 0x55AA382D }
+  },
+  [](const std::string& filename, std::vector<std::string>& args) { NintendoFile::start(filename, args); }
+});
+
 std::vector<uint8_t> NintendoFile::start(std::string filename, std::vector<std::string>& args)
 {
-  return start(util::read_file(filename), args, filename);
+  auto data = util::read_file(filename);
+  return start(data, args, filename);
   //return start(std::vector<uint8_t>(), args, filename);
 }
 
-std::vector<uint8_t> NintendoFile::start(std::vector<uint8_t>& data, std::vector<std::string>& args, std::string filename)
+//  Level used when a corruption doesn't give --compression
+static yaz0::Level default_level = yaz0::Level::Tight;
+
+void NintendoFile::set_default_compression(yaz0::Level level)
 {
-  /*
-  //  Won't be used in this version. Looking for a better way to structure this than an if/else if block.
-  std::vector<Corrupter> candidates;
+  default_level = level;
+}
 
-  candidates.push_back(Corrupter(BCKFile::corrupt, BCKFile::match));
-  candidates.push_back(Corrupter(BTPFile::corrupt, BTPFile::match));
-  candidates.push_back(Corrupter(BMDFile::corrupt, BMDFile::match));
-  candidates.push_back(Corrupter(BMTFile::corrupt, BMTFile::match));
-  candidates.push_back(Corrupter(U8File::corrupt, U8File::match));
-  */
+/*
+  Takes --compression out of the arguments.
 
-  uint64_t current = 0;
+  @return the level it names, or the default level without it.
+*/
+static yaz0::Level compression(std::vector<std::string>& args)
+{
+  auto flag = std::find(args.begin(), args.end(), "--compression");
 
-  if (data.size() < 4)
+  if (flag != args.end() && flag + 1 != args.end())
   {
-    return data;
+    yaz0::Level level = yaz0::level(*(flag + 1));
+    args.erase(flag, flag + 2);
+    return level;
   }
 
-  bool yaz0 = util::read(data, 0, 4) == "Yaz0";
-  bool yay0 = util::read(data, 0, 4) == "Yay0";
+  return default_level;
+}
 
-  if (yaz0)
-  {
-    data = yaz0::decode(data);
-  }
+std::vector<uint8_t> NintendoFile::start(std::vector<uint8_t>& data, std::vector<std::string>& args, std::string filename, uint64_t stream)
+{
+  yaz0::Level level = compression(args);
 
-  if (yay0)
+  if (data.size() < 4)
   {
-    data = yay0::decode(data);
+    return data;
   }
 
-  std::string magic = util::read(data, 0, 4);
+  uint32_t magic = util::read_big<uint32_t>(data);
+  bool yaz0 = magic == formats::fourcc("Yaz0");
+  bool yay0 = magic == formats::fourcc("Yay0");
 
   try
   {
-    if (magic == "RARC")
+    if (yaz0)
     {
-      auto rarc = std::make_unique<RARCFile>(data, args);
-      data = rarc->corrupt();
+      data = yaz0::decode(data);
     }
-    else if (magic == "J3D1")
-    {
-      //  For lack of a better approach, similar J3D1-header files will use BCKFile
-      if (util::read(data, 4, 4) == "bck1" ||
-          util::read(data, 4, 4) == "btk1")
-      {
-        BCKFile::corrupt(data, args);
-      }
-      else if (util::read(data, 4, 4) == "btp1")
-      {
-        //  BTP only needs to jump 0x20 bytes before corrupting
-        BTPFile::corrupt(data, args);
-      }
-    }
-    else if (magic == "J3D2")
-    {
-      if (util::read(data, 4, 4) == "bmd3")
-      {
-        BMDFile::corrupt(data, args);
-      }
-      else if (util::read(data, 4, 4) == "bmt3")
-      {
-        //  Just a MAT block of a BMD file
-        BMTFile::corrupt(data, args);
-      }
-    }
-    else if (util::read_big<uint32_t>(data) == 0x55AA382D)
-    {
-      U8File::corrupt(data, args);
-    }
-    else
+
+    if (yay0)
     {
-      NintendoFile::corrupt(data, args);
+      data = yay0::decode(data);
     }
   }
-  catch (...)
+  catch (const InvalidRomException& e)
   {
-    std::cout << "Error corrupting '" << filename << "'" << std::endl;
+    //  Nothing was changed, so the file is left as it is
+    std::cout << "Error decoding '" << filename << "': " << e.what() << std::endl;
+    return data;
   }
 
-  /*
-    Decoding is disabled for now
+  dispatch(data, args, filename, stream);
+
+  //  Games expect their files in the compression they shipped with
   if (yaz0)
   {
-    //std::cout << "Yaz0 Encoding... ";
-    //data = yaz0::encode(data);
-    //std::cout << "Done" << std::endl;
+    data = yaz0::encode(data, level);
+  }
+
+  if (yay0)
+  {
+    data = yay0::encode(data, level);
   }
-  */
 
   auto info = std::make_unique<CorruptionInfo>(args);
 
@@ -123,99 +118,77 @@ std::vector<uint8_t> NintendoFile::start(std::vector<uint8_t>& data, std::vector
   return data;
 }
 
-void NintendoFile::corrupt(std::vector<uint8_t>& data, std::vector<std::string>& args)
-{
-  auto info = std::make_unique<CorruptionInfo>(args);
-  uint32_t corruptions = 0;
-
-  std::random_device rd;
-  std::mt19937 random;
-  std::uniform_int_distribution<int> dist(0x00, 0xFF);
+/*
+  Corrupts an uncompressed file by its type, where it is. Archives corrupt
+  each of their files through here as views into the archive.
 
-  std::vector<uint32_t> v(std::mt19937::state_size);
-  std::generate(v.begin(), v.end(), ref(rd));
-  std::seed_seq seed(v.begin(), v.end());
-  random.seed(seed);
+  @param data - The file
+  @param args - Arguments of the corruption
+  @param filename - Name of the file for errors
+  @param stream - Random stream of the file
+*/
+void NintendoFile::dispatch(util::ByteView data, std::vector<std::string>& args, std::string filename, uint64_t stream)
+{
+  if (data.size() < 4)
+  {
+    return;
+  }
 
-  for (uint32_t i = info->start();        // Start at header + start value
-    i < data.size() && i < info->end();   // While in a valid range
-    i += info->step())                    // Increase by step size
+  try
   {
-    if (info->type() == CorruptionType::Shift)
+    switch (data.read_big<uint32_t>())
+    {
+    case formats::fourcc("RARC"):
     {
-      //  If it's okay to put the other byte in this position then change it
-      if (i + info->value() < data.size())
+      auto rarc = std::make_unique<RARCFile>(data, args);
+      rarc->corrupt(stream);
+      break;
+    }
+    case formats::fourcc("J3D1"):
+      //  For lack of a better approach, similar J3D1-header files will use BCKFile
+      switch (data.read_big<uint32_t>(4))
       {
-        corruptions++;
-        data[i] = data[i + info->value()];
+      case formats::fourcc("bck1"):
+      case formats::fourcc("btk1"):
+        BCKFile::corrupt(data, args, stream);
+        break;
+      case formats::fourcc("btp1"):
+        //  BTP only needs to jump 0x20 bytes before corrupting
+        BTPFile::corrupt(data, args, stream);
+        break;
       }
-    }
-    else if (info->type() == CorruptionType::Swap)
-    {
-      if (i + info->value() < data.size())
+      break;
+    case formats::fourcc("J3D2"):
+      switch (data.read_big<uint32_t>(4))
       {
-        corruptions++;
-        uint8_t temp = data[i + info->value()];
-        data[i] = temp;
-        data[i + info->value()] = temp;
+      case formats::fourcc("bmd3"):
+        BMDFile::corrupt(data, args, stream);
+        break;
+      case formats::fourcc("bmt3"):
+        //  Just a MAT block of a BMD file
+        BMTFile::corrupt(data, args, stream);
+        break;
       }
+      break;
+    case 0x55AA382D:
+      U8File::corrupt(data, args, stream);
+      break;
+    default:
+      NintendoFile::corrupt(data, args, stream);
+      break;
     }
-    else if (info->type() == CorruptionType::Add)
-    {
-      //  If the new byte value is valid then do the corruption
-      corruptions++;
-      data[i] += info->value();
-    }
-    else if (info->type() == CorruptionType::Set)
-    {
-      //  If the set value can be placed here then do it
-      corruptions++;
-      data[i] = info->value();
-    }
-    else if (info->type() == CorruptionType::Random)
-    {
-      corruptions++;
-      data[i] = dist(random);
-    }
-    else if (info->type() == CorruptionType::RotateLeft)
-    {
-      uint8_t rotate = util::rol<uint8_t>(data[i], info->value());
+  }
+  catch (...)
+  {
+    std::cout << "Error corrupting '" << filename << "'" << std::endl;
+  }
+}
 
-      data[i] = rotate;
-      corruptions++;
-    }
-    else if (info->type() == CorruptionType::RotateRight)
-    {
-      uint8_t rotate = util::ror<uint8_t>(data[i], info->value());
+void NintendoFile::corrupt(util::ByteView data, std::vector<std::string>& args, uint64_t stream)
+{
+  auto info = std::make_unique<CorruptionInfo>(args);
 
-      data[i] = rotate;
-      corruptions++;
-    }
-    else if (info->type() == CorruptionType::LogicalAnd)
-    {
-      data[i] &= info->value();
-      corruptions++;
-    }
-    else if (info->type() == CorruptionType::LogicalOr)
-    {
-      data[i] |= info->value();
-      corruptions++;
-    }
-    else if (info->type() == CorruptionType::LogicalXor)
-    {
-      data[i] ^= info->value();
-      corruptions++;
-    }
-    else if (info->type() == CorruptionType::LogicalComplement)
-    {
-      data[i] = ~data[i];
-      corruptions++;
-    }
-    else
-    {
-      break;  //  No corruption selected, might as well quit.
-    }
-  }
+  uint64_t corruptions = engine::corrupt(data.data(), data.size(), engine::Options(*info), engine::Unprotected(), rng::derive(info->seed(), stream));
 
   //  Use stringstream so that lines won't be mangled from multi-threading
   std::stringstream ss;
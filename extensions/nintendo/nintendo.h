@@ -4,7 +4,6 @@
 #include <vector>
 #include <memory>
 #include <cstdint>
-#include <random>
 #include <functional>
 
 #include "corrupt.h"
@@ -12,23 +11,23 @@
 #include "yaz0.h"
 #include "yay0.h"
 
-struct Corrupter
-{
-  Corrupter(std::function<void(std::vector<uint8_t>&, std::vector<std::string>&)> c,
-            std::function<bool(std::vector<uint8_t>&)> m) : m_corrupt(c), m_match(m) {};
-private:
-  std::function<void(std::vector<uint8_t>&, std::vector<std::string>&)> m_corrupt;
-  std::function<bool(std::vector<uint8_t>&)> m_match;
-};
-
 class NintendoFile
 {
 public:
   virtual ~NintendoFile();
 
   static std::vector<uint8_t> start(std::string file, std::vector<std::string>& args);
-  static std::vector<uint8_t> start(std::vector<uint8_t>& data, std::vector<std::string>& args, std::string filename = "");
-  static void corrupt(std::vector<uint8_t>& data, std::vector<std::string>& args);
+  static std::vector<uint8_t> start(std::vector<uint8_t>& data, std::vector<std::string>& args, std::string filename = "", uint64_t stream = 0);
+  static void dispatch(util::ByteView data, std::vector<std::string>& args, std::string filename = "", uint64_t stream = 0);
+  static void corrupt(util::ByteView data, std::vector<std::string>& args, uint64_t stream = 0);
+
+  /*
+    Sets the level compressed files are encoded with when --compression is
+    not given. Must be set before any file is corrupted.
+
+    @param level - The level to use
+  */
+  static void set_default_compression(yaz0::Level level);
 
   virtual bool valid_byte() = 0;
 };
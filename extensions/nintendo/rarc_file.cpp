@@ -5,7 +5,7 @@ namespace rarc
   namespace detail
   {
     FileEntry::FileEntry() { }
-    FileEntry::FileEntry(std::vector<uint8_t>& data, uint32_t offset)
+    FileEntry::FileEntry(util::ByteView data, uint32_t offset)
     {
       m_id = util::read_big<uint16_t>(data, offset + FileEntryOffset::ID);
       unknown1 = util::read_big<uint16_t>(data, offset + FileEntryOffset::Unknown1);
@@ -16,7 +16,7 @@ namespace rarc
       zero = util::read_big<uint32_t>(data, offset + FileEntryOffset::Zero);
     }
 
-    Header::Header(std::vector<uint8_t>& data, uint32_t offset)
+    Header::Header(util::ByteView data, uint32_t offset)
     {
       //  Set up header data
       magic = util::read(data, offset + HeaderOffset::Magic, 4);
@@ -38,7 +38,7 @@ namespace rarc
       unknown5 = util::read_big<uint64_t>(data, offset + HeaderOffset::Unknown5);
     }
 
-    Node::Node(std::vector<uint8_t>& data, std::unique_ptr<detail::Header>& header, uint32_t offset, std::string parent)
+    Node::Node(util::ByteView data, std::unique_ptr<detail::Header>& header, uint32_t offset, std::string parent)
     {
       type = util::read(data, offset + NodeOffset::Type, 4);
       string_offset = util::read_big<uint32_t>(data, offset + NodeOffset::StringTableOffset);
@@ -76,7 +76,7 @@ namespace rarc
     }
   }
 
-  RARCFile::RARCFile(std::vector<uint8_t>& data, std::vector<std::string>& args)
+  RARCFile::RARCFile(util::ByteView data, std::vector<std::string>& args)
   {
     info = std::make_unique<CorruptionInfo>(args);
     header = std::make_unique<detail::Header>(data);
@@ -94,8 +94,8 @@ namespace rarc
       entries.insert(comp.begin(), comp.end());
     }
 
-    //  Create a copy of the file data to pull individual files from
-    this->data.insert(this->data.end(), data.begin(), data.end());
+    //  Files are corrupted where they are in the archive
+    this->data = data;
 
     //  Save arguments 
     this->arguments = args;
@@ -117,7 +117,7 @@ namespace rarc
     return files;
   }
 
-  std::vector<uint8_t> RARCFile::corrupt()
+  void RARCFile::corrupt(uint64_t stream)
   {
     //  Commented section corrupts individual files passed on the command line
     //  which won't be used until the GUI has a better design
@@ -156,27 +156,22 @@ namespace rarc
         continue;
       }
 
-      std::vector<uint8_t> filedata(data.begin() + offset, data.begin() + offset + entry.size());
+      util::ByteView filedata = data.sub(offset, entry.size());
 
       //  If the file is Yay0 or Yaz0 compressed then ignore it since the sizes most likely won't match
       if (filedata.size() > 4 && util::read(filedata, 0, 4) != "Yaz0" && util::read(filedata, 0, 4) != "Yay0")
       {
         //  Since RARC files are archives of Nintendo files, corrupt it with Nintendo file protection
-        NintendoFile::start(filedata, arguments);
-
-        //  Copy the corrupted bytes back into place
-        //  NOTE: This does not account for differing sizes for Yaz0 compressed files!
-        std::copy(filedata.begin(), filedata.begin() + entry.size(), data.begin() + offset);
+        //  Files get their stream from their path so they don't depend on the order of the archive
+        NintendoFile::dispatch(filedata, arguments, e.first, rng::derive(stream, rng::hash(e.first)));
       }
     }
-
-    return data;
   }
 
   void RARCFile::save(std::string filename)
   {
     std::ofstream ofs(filename, std::ios::binary);
-    ofs.write(reinterpret_cast<char *>(&data[0]), data.size());
+    ofs.write(reinterpret_cast<char *>(data.data()), data.size());
     ofs.close();
   }
 }
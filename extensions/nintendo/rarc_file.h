@@ -12,7 +12,7 @@ namespace rarc
     struct FileEntry
     {
       FileEntry();
-      FileEntry(std::vector<uint8_t>& data, uint32_t offset = 0);
+      FileEntry(util::ByteView data, uint32_t offset = 0);
 
       inline uint32_t offset()
       {
@@ -90,7 +90,7 @@ namespace rarc
 
     struct Header
     {
-      Header(std::vector<uint8_t>& data, uint32_t offset = 0);
+      Header(util::ByteView data, uint32_t offset = 0);
 
       bool valid()
       {
@@ -154,7 +154,7 @@ namespace rarc
     };
     struct Node
     {
-      Node(std::vector<uint8_t>& data, std::unique_ptr<detail::Header>& header, uint32_t offset = 0, std::string parent = "./");
+      Node(util::ByteView data, std::unique_ptr<detail::Header>& header, uint32_t offset = 0, std::string parent = "./");
 
       inline uint32_t count()
       {
@@ -206,9 +206,9 @@ namespace rarc
   class RARCFile
   {
   public:
-    RARCFile(std::vector<uint8_t>& data, std::vector <std::string>& args);
+    RARCFile(util::ByteView data, std::vector <std::string>& args);
 
-    std::vector<uint8_t> corrupt();
+    void corrupt(uint64_t stream = 0);
     void save(std::string filename);
 
   private:
@@ -217,7 +217,7 @@ namespace rarc
 
     std::vector<detail::Node> nodes;
     std::map<std::string, detail::FileEntry> entries;
-    std::vector<uint8_t> data;
+    util::ByteView data;  //  The archive, which is corrupted where it is
     std::vector<std::string> arguments;
 
 
@@ -12,7 +12,7 @@ namespace u8
       static const uint32_t EntrySize = 0x0C;
 
       FileEntry() : m_begin_or_index(0), m_type_and_offset(0), m_size_or_index_first(0) {};
-      FileEntry(std::vector<uint8_t>& data, uint32_t offset = 0);
+      FileEntry(util::ByteView data, uint32_t offset = 0);
 
       inline bool is_file()
       {
@@ -73,7 +73,7 @@ namespace u8
 
     struct FST
     {
-      FST(std::vector<uint8_t>& data, uint32_t offset = 0);
+      FST(util::ByteView data, uint32_t offset = 0);
 
       inline uint32_t file_count()
       {
@@ -104,7 +104,7 @@ namespace u8
 
     struct Header
     {
-      Header(std::vector<uint8_t>& data, uint32_t offset = 0);
+      Header(util::ByteView data, uint32_t offset = 0);
 
       inline uint32_t node_offset()
       {
@@ -139,11 +139,11 @@ namespace u8
   class U8File
   {
   public:
-    U8File(std::vector<uint8_t>& data, std::vector<std::string>& args);
+    U8File(util::ByteView data, std::vector<std::string>& args);
 
-    static std::vector<uint8_t> corrupt(std::vector<uint8_t>& data, std::vector<std::string>& args);
+    static void corrupt(util::ByteView data, std::vector<std::string>& args, uint64_t stream = 0);
 
-    static inline bool match(std::vector<uint8_t>& data)
+    static inline bool match(util::ByteView data)
     {
       return util::read_big<uint32_t>(data) == 0x55AA382D;
     }
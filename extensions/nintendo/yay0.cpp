@@ -1,86 +1,140 @@
 #include "yay0.h"
 
+#include <algorithm>
+#include <cstring>
+
+#include "corruption_exceptions.h"
+
 namespace yay0
 {
+  namespace detail
+  {
+    Writer::Writer(uint32_t size) : m_size(size), m_count(0)
+    {
+      //  Room for every byte being copied, so nothing grows while encoding
+      m_codes.reserve((size + 31) / 32);
+      m_data.reserve(size);
+    }
+
+    std::vector<uint8_t> Writer::finish()
+    {
+      uint32_t countOffset = 0x10 + m_codes.size() * 4;
+      uint32_t dataOffset = countOffset + m_links.size();
+
+      std::vector<uint8_t> ret(dataOffset + m_data.size());
+
+      std::memcpy(&ret[0], "Yay0", 4);
+
+      const uint32_t header[] = { m_size, countOffset, dataOffset };
+
+      for (uint32_t i = 0; i < 3; i++)
+      {
+        ret[4 + i * 4] = (header[i] >> 24) & 0xFF;
+        ret[5 + i * 4] = (header[i] >> 16) & 0xFF;
+        ret[6 + i * 4] = (header[i] >> 8) & 0xFF;
+        ret[7 + i * 4] = header[i] & 0xFF;
+      }
+
+      for (uint32_t i = 0; i < m_codes.size(); i++)
+      {
+        ret[0x10 + i * 4] = (m_codes[i] >> 24) & 0xFF;
+        ret[0x11 + i * 4] = (m_codes[i] >> 16) & 0xFF;
+        ret[0x12 + i * 4] = (m_codes[i] >> 8) & 0xFF;
+        ret[0x13 + i * 4] = m_codes[i] & 0xFF;
+      }
+
+      std::copy(m_links.begin(), m_links.end(), ret.begin() + countOffset);
+      std::copy(m_data.begin(), m_data.end(), ret.begin() + dataOffset);
+
+      return ret;
+    }
+  }
+
   /*
       This function was adapted from thakis' Yay0 decoder.
       You can find the source to that here: http://www.amnoid.de/gc/yay0dec.zip
   */
-  Ret decodeYay0(std::vector<uint8_t>& codes, std::vector<uint8_t>& counts, std::vector<uint8_t>& srcData, std::vector<uint8_t>& dst, int uncompressedSize)
+  Ret decodeYay0(util::ByteView src, uint32_t countOffset, uint32_t dataOffset, uint8_t* dst, uint32_t uncompressedSize)
   {
-    Ret r = { 0, 0 };
-    //int srcPlace = 0, dstPlace = 0; //current read/write positions
+    Ret r = { dataOffset, 0 };
 
-    uint32_t codePos = 0;
-    uint32_t countPos = 0;
+    //  Codes are 32 bit big endian words, which is the same as reading them a byte at a time
+    uint32_t codePos = 0x10;
+    uint32_t countPos = countOffset;
+    uint32_t size = src.size();
 
-    uint32_t validBitCount = 0; //number of valid bits left in "code" byte
-    uint8_t currCodeByte;
     while (r.dstPos < uncompressedSize)
     {
-      //read new "code" byte if the current one is used up
-      if (validBitCount == 0)
+      if (codePos >= size)
       {
-        currCodeByte = codes[codePos];
-        ++codePos;
-        validBitCount = 8;
+        throw InvalidRomException("Yay0 codes end early.");
       }
 
-      if ((currCodeByte & 0x80) != 0)
-      {
-        //straight copy
-        dst[r.dstPos] = srcData[r.srcPos];
-        r.dstPos++;
-        r.srcPos++;
-        //if(r.srcPos >= srcSize)
-        //  return r;
-      }
-      else
+      uint8_t group = src[codePos++];
+
+      for (uint32_t code = 0; code < 8 && r.dstPos < uncompressedSize; code++, group <<= 1)
       {
-        //RLE part
-        uint8_t byte1 = counts[countPos];
-        uint8_t byte2 = counts[countPos + 1];
+        if (group & 0x80)
+        {
+          if (r.srcPos >= size)
+          {
+            throw InvalidRomException("Yay0 data ends early.");
+          }
+
+          dst[r.dstPos++] = src[r.srcPos++];
+          continue;
+        }
+
+        if (countPos >= size || size - countPos < 2)
+        {
+          throw InvalidRomException("Yay0 links end early.");
+        }
+
+        uint8_t byte1 = src[countPos];
+        uint8_t byte2 = src[countPos + 1];
         countPos += 2;
-        //if(r.srcPos >= srcSize)
-        //  return r;
 
-        uint32_t dist = ((byte1 & 0xF) << 8) | byte2;
-        uint32_t copySource = r.dstPos - (dist + 1);
+        uint32_t distance = (((byte1 & 0xF) << 8) | byte2) + 1;
+        uint32_t length = byte1 >> 4;
 
-        uint32_t numBytes = byte1 >> 4;
-        if (numBytes == 0)
+        if (length == 0)
         {
-          numBytes = srcData[r.srcPos] + 0x12;
-          r.srcPos++;
-          //if(r.srcPos >= srcSize)
-          //  return r;
+          if (r.srcPos >= size)
+          {
+            throw InvalidRomException("Yay0 data ends early.");
+          }
+
+          length = src[r.srcPos++] + 0x12;
         }
         else
         {
-          numBytes += 2;
+          length += 2;
         }
 
-        //copy run
-        for (uint32_t i = 0; i < numBytes; ++i)
+        if (distance > r.dstPos)
         {
-          dst[r.dstPos] = dst[copySource];
-          copySource++;
-          r.dstPos++;
+          throw InvalidRomException("Yay0 copy starts before the data.");
         }
-      }
 
-      //use next bit from "code" byte
-      currCodeByte <<= 1;
-      validBitCount -= 1;
+        //  A copy that runs past the size in the header is cut there
+        length = std::min(length, uncompressedSize - r.dstPos);
+
+        yaz0::detail::copy_match(dst + r.dstPos, distance, length);
+        r.dstPos += length;
+      }
     }
 
     return r;
   }
 
+  std::vector<uint8_t> encode(util::ByteView src, yaz0::Level level)
+  {
+    return yaz0::detail::encode<detail::Writer>(src, level);
+  }
 
-  std::vector<uint8_t> decode(std::vector<uint8_t>& src)
+  std::vector<uint8_t> decode(util::ByteView src)
   {
-    if (util::read(src, 0, 4) != "Yay0")
+    if (src.size() < 0x10 || std::memcmp(src.data(), "Yay0", 4) != 0)
     {
       return std::vector<uint8_t>();
     }
@@ -89,12 +143,17 @@ namespace yay0
     uint32_t countOffset = util::read_big<uint32_t>(src, 8);
     uint32_t dataOffset = util::read_big<uint32_t>(src, 12);
 
+    //  Both streams start after the header and inside of the file
+    if (countOffset < 0x10 || countOffset > src.size() || dataOffset < 0x10 || dataOffset > src.size())
+    {
+      throw InvalidRomException("Yay0 header points outside of the file.");
+    }
 
-    std::vector<uint8_t> dst(decodedSize + 0x1000);
+    //  The streams are read in place, only the output is allocated
+    std::vector<uint8_t> dst(decodedSize);
 
-    //Ret r = decodeYay0(src + 16, src + countOffset, src + dataOffset, dst, decodedSize);
-    Ret r = decodeYay0(util::subset(src, 16, src.size() - 16), util::subset(src, countOffset, src.size() - countOffset), util::subset(src, dataOffset, src.size() - dataOffset), dst, decodedSize);
+    decodeYay0(src, countOffset, dataOffset, dst.data(), decodedSize);
 
     return dst;
   }
-}
\ No newline at end of file
+}
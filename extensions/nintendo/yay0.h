@@ -1,15 +1,126 @@
+#ifndef _YAY0_COMPRESSION_H
+#define _YAY0_COMPRESSION_H
+
+/*
+  Yay0 holds the same codes as Yaz0, but in three streams that follow each
+  other instead of one:
+
+    0x00 "Yay0"
+    0x04 Decompressed size
+    0x08 Offset of the links
+    0x0C Offset of the data
+    0x10 Code bits, in 32 bit words
+
+  A set bit copies the next byte of the data, a clear one reads a 2 byte
+  link that copies from earlier in the output. The top 4 bits of a link
+  are the length - 2 and the rest are the distance - 1. A length of 0 is
+  followed by a byte in the data that is the length - 0x12.
+*/
+
 #include <vector>
 #include <cstdint>
 
 #include "util.h"
+#include "yaz0.h"
 
 namespace yay0
 {
   struct Ret
   {
-    int srcPos, dstPos;
+    uint32_t srcPos, dstPos;
   };
 
-  Ret decodeYay0(std::vector<uint8_t>& codes, std::vector<uint8_t>& counts, std::vector<uint8_t>& srcData, std::vector<uint8_t>& dst, int uncompressedSize);
-  std::vector<uint8_t> decode(std::vector<uint8_t>& src);
-}
\ No newline at end of file
+  namespace detail
+  {
+    /*
+      Collects the three streams for the encoder that yaz0 shares, and puts
+      them together once every code is known.
+    */
+    class Writer
+    {
+    public:
+      Writer(uint32_t size);
+
+      inline void literal(uint8_t value)
+      {
+        code(true);
+        m_data.push_back(value);
+      }
+
+      /*
+        @param distance - How far back the match starts, 1 to 0x1000
+        @param length - Length of the match, 3 to 0x111
+      */
+      inline void match(uint32_t distance, uint32_t length)
+      {
+        code(false);
+        distance--;
+
+        if (length >= 0x12)
+        {
+          m_links.push_back(static_cast<uint8_t>(distance >> 8));
+          m_links.push_back(static_cast<uint8_t>(distance));
+          m_data.push_back(static_cast<uint8_t>(length - 0x12));
+        }
+        else
+        {
+          m_links.push_back(static_cast<uint8_t>(((length - 2) << 4) | (distance >> 8)));
+          m_links.push_back(static_cast<uint8_t>(distance));
+        }
+      }
+
+      /*
+        @return the encoded data.
+      */
+      std::vector<uint8_t> finish();
+    private:
+      inline void code(bool literal)
+      {
+        if (m_count == 0)
+        {
+          m_codes.push_back(0);
+        }
+
+        if (literal)
+        {
+          m_codes.back() |= 0x80000000 >> m_count;
+        }
+
+        m_count = (m_count + 1) & 31;
+      }
+
+      uint32_t m_size;
+      std::vector<uint32_t> m_codes;  //  32 codes in each word
+      std::vector<uint8_t> m_links;
+      std::vector<uint8_t> m_data;
+      uint32_t m_count;               //  Codes in the last word
+    };
+  }
+
+  /*
+    Decodes the streams of a Yay0 file. Throws InvalidRomException when a
+    stream runs past the end of the file or a link copies from before the
+    start of the output.
+
+    @param src - The whole file
+    @param countOffset - Offset of the links
+    @param dataOffset - Offset of the data
+    @param dst - Output of uncompressedSize bytes
+    @param uncompressedSize - Size from the header
+
+    @return how far the data was read and the bytes written to dst.
+  */
+  Ret decodeYay0(util::ByteView src, uint32_t countOffset, uint32_t dataOffset, uint8_t* dst, uint32_t uncompressedSize);
+
+  /*
+    @param src - Data to encode
+    @param level - How hard to look for matches
+
+    @return src as Yay0.
+  */
+  std::vector<uint8_t> encode(util::ByteView src, yaz0::Level level = yaz0::Level::Tight);
+
+  std::vector<uint8_t> decode(util::ByteView src);
+}
+
+#endif
@@ -1,12 +1,16 @@
 #include "yaz0.h"
 #include <algorithm>
+#include <cctype>
+#include <cstring>
+
+#include "corruption_exceptions.h"
 
 namespace yaz0
 {
   namespace detail
   {
     // simple and straight encoding scheme for Yaz0
-    uint32_t simpleEnc(const std::vector<uint8_t>& src, uint32_t size, uint32_t pos, uint32_t& outPos)
+    uint32_t simpleEnc(util::ByteView src, uint32_t size, uint32_t pos, uint32_t& outPos)
     {
       int numBytes = 1;
       int startPos = std::max(0, static_cast<int>(pos - 0x1000));
@@ -34,110 +38,167 @@ namespace yaz0
       return numBytes == 2 ? 1 : numBytes;
     }
 
-    // a lookahead encoding scheme for ngc Yaz0
-    uint32_t Encoder::nintendoEnc(const std::vector<uint8_t>& src, uint32_t size, uint32_t pos, uint32_t& pMatchPos)
+    HashChain::HashChain(util::ByteView src, uint32_t depth, uint32_t begin) : m_src(src), m_depth(depth), m_head(1 << HashBits, 0), m_prev(Window, 0), m_next(begin > Window ? begin - Window : 0)
+    {
+    }
+
+    void HashChain::insert(uint32_t pos)
+    {
+      uint32_t key = hash(pos);
+
+      m_prev[pos % Window] = m_head[key];
+      m_head[key] = pos + 1;
+    }
+
+    uint32_t HashChain::find(uint32_t pos, uint32_t& match)
     {
-      int startPos = pos - 0x1000;
-      uint32_t numBytes = 1;
+      uint32_t size = m_src.size();
+
+      //  Only positions with three bytes after them can start a match
+      for (; m_next < pos && m_next + 2 < size; m_next++)
+      {
+        insert(m_next);
+      }
 
-      // if prevFlag is set, it means that the previous position was determined by look-ahead try.
-      // so just use it. this is not the best optimization, but nintendo's choice for speed.
-      if (prevFlag == 1)
+      if (pos + 2 >= size)
       {
-        pMatchPos = matchPos;
-        prevFlag = 0;
-        return numBytes1;
+        return 1;
       }
 
-      prevFlag = 0;
-      numBytes = simpleEnc(src, size, pos, matchPos);
-      pMatchPos = matchPos;
+      uint32_t limit = std::min(size - pos, MaxMatch);
+      uint32_t best = 0;
+      uint32_t depth = 0;
 
-      // if this position is RLE encoded, then compare to copying 1 byte and next position(pos+1) encoding
-      if (numBytes >= 3) 
+      for (uint32_t link = m_head[hash(pos)]; link != 0 && depth < m_depth; depth++)
       {
-        numBytes1 = simpleEnc(src, size, pos + 1, matchPos);
+        uint32_t candidate = link - 1;
+
+        //  Slots are reused once a position leaves the window, which ends the chain
+        if (candidate >= pos || pos - candidate > Window)
+        {
+          break;
+        }
 
-        // if the next position encoding is +2 longer than current position, choose it.
-        // this does not guarantee the best optimization, but fairly good optimization with speed.
-        if (numBytes1 >= numBytes + 2)
+        //  Can't beat the best match unless it matches at the byte that would make it longer
+        if (m_src[candidate + best] == m_src[pos + best])
         {
-          numBytes = 1;
-          prevFlag = 1;
+          uint32_t length = 0;
+
+          while (length < limit && m_src[candidate + length] == m_src[pos + length])
+          {
+            length++;
+          }
+
+          if (length > best)
+          {
+            best = length;
+            match = candidate;
+
+            if (best == limit)
+            {
+              break;
+            }
+          }
         }
+
+        link = m_prev[candidate % Window];
       }
 
-      return numBytes;
+      return best < 3 ? 1 : best;
     }
 
-    Ret decodeYaz0(uint8_t* src, uint32_t srcSize, uint8_t* dst, uint32_t uncompressedSize)
+    Writer::Writer(uint32_t size) : m_out(0x10 + size + (size + 7) / 8), m_pos(0x10), m_group(0), m_count(0)
     {
-      Ret r = { 0, 0 };
-      //int srcPlace = 0, dstPlace = 0; //current read/write positions
+      m_out[0] = 'Y';
+      m_out[1] = 'a';
+      m_out[2] = 'z';
+      m_out[3] = '0';
+
+      m_out[4] = (size >> 24) & 0xFF;
+      m_out[5] = (size >> 16) & 0xFF;
+      m_out[6] = (size >> 8) & 0xFF;
+      m_out[7] = size & 0xFF;
+    }
 
-      uint32_t validBitCount = 0; //number of valid bits left in "code" byte
-      uint8_t currCodeByte;
+    std::vector<uint8_t> Writer::finish()
+    {
+      m_out.resize(m_pos);
+      m_out.shrink_to_fit();
+      return std::move(m_out);
+    }
+
+    Ret decodeYaz0(const uint8_t* src, uint32_t srcSize, uint8_t* dst, uint32_t uncompressedSize)
+    {
+      Ret r = { 0, 0 };
 
       while (r.dstPos < uncompressedSize)
       {
-        //read new "code" byte if the current one is used up
-        if (validBitCount == 0)
+        if (r.srcPos >= srcSize)
         {
-          currCodeByte = src[r.srcPos];
-          ++r.srcPos;
-          validBitCount = 8;
+          throw InvalidRomException("Yaz0 data ends early.");
         }
 
-        if ((currCodeByte & 0x80) != 0)
+        uint8_t group = src[r.srcPos++];
+
+        //  Eight copied bytes in a row are common in data that doesn't compress well
+        if (group == 0xFF && srcSize - r.srcPos >= 8 && uncompressedSize - r.dstPos >= 8)
         {
-          //straight copy
-          dst[r.dstPos] = src[r.srcPos];
-          r.dstPos++;
-          r.srcPos++;
-          //if(r.srcPos >= srcSize)
-          //  return r;
+          std::memcpy(dst + r.dstPos, src + r.srcPos, 8);
+          r.srcPos += 8;
+          r.dstPos += 8;
+          continue;
         }
-        else
+
+        for (uint32_t code = 0; code < 8 && r.dstPos < uncompressedSize; code++, group <<= 1)
         {
-          //RLE part
+          if (group & 0x80)
+          {
+            if (r.srcPos >= srcSize)
+            {
+              throw InvalidRomException("Yaz0 data ends early.");
+            }
+
+            dst[r.dstPos++] = src[r.srcPos++];
+            continue;
+          }
+
+          if (srcSize - r.srcPos < 2)
+          {
+            throw InvalidRomException("Yaz0 data ends early.");
+          }
+
           uint8_t byte1 = src[r.srcPos];
           uint8_t byte2 = src[r.srcPos + 1];
           r.srcPos += 2;
-          //if(r.srcPos >= srcSize)
-          //  return r;
 
-          uint32_t dist = ((byte1 & 0xF) << 8) | byte2;
-          uint32_t copySource = r.dstPos - (dist + 1);
+          uint32_t distance = (((byte1 & 0xF) << 8) | byte2) + 1;
+          uint32_t length = byte1 >> 4;
 
-          if (r.dstPos < (dist + 1))
+          if (length == 0)
           {
-            throw;
-          }
+            if (r.srcPos >= srcSize)
+            {
+              throw InvalidRomException("Yaz0 data ends early.");
+            }
 
-          uint32_t numBytes = byte1 >> 4;
-          if (numBytes == 0)
-          {
-            numBytes = src[r.srcPos] + 0x12;
-            r.srcPos++;
-            //if(r.srcPos >= srcSize)
-            //  return r;
+            length = src[r.srcPos++] + 0x12;
           }
           else
-            numBytes += 2;
-
-          //copy run
+          {
+            length += 2;
+          }
 
-          for (uint32_t i = 0; i < numBytes; ++i)
+          if (distance > r.dstPos)
           {
-            dst[r.dstPos] = dst[copySource];
-            copySource++;
-            r.dstPos++;
+            throw InvalidRomException("Yaz0 copy starts before the data.");
           }
-        }
 
-        //use next bit from "code" byte
-        currCodeByte <<= 1;
-        validBitCount -= 1;
+          //  A copy that runs past the size in the header is cut there
+          length = std::min(length, uncompressedSize - r.dstPos);
+
+          copy_match(dst + r.dstPos, distance, length);
+          r.dstPos += length;
+        }
       }
 
       return r;
@@ -146,172 +207,84 @@ namespace yaz0
 
   std::vector<uint8_t> encode(std::string filename)
   {
-    return encode(util::read_file(filename));
+    auto src = util::read_file(filename);
+    return encode(src);
   }
 
   std::vector<uint8_t> decode(std::string filename)
   {
-    return decode(util::read_file(filename));
+    auto src = util::read_file(filename);
+    return decode(src);
   }
 
-  std::vector<uint8_t> encode(std::vector<uint8_t>& src)
+  Level level(const std::string& name)
   {
-    std::vector<uint8_t> ret;
-
-    ret.push_back('Y');
-    ret.push_back('a');
-    ret.push_back('z');
-    ret.push_back('0');
+    std::string lower(name);
+    std::transform(lower.begin(), lower.end(), lower.begin(), [](char c) { return static_cast<char>(std::tolower(c)); });
 
-    ret.push_back((src.size() & 0xFF000000) >> 24);
-    ret.push_back((src.size() & 0x00FF0000) >> 16);
-    ret.push_back((src.size() & 0x0000FF00) >> 8);
-    ret.push_back((src.size() & 0x000000FF));
-
-    for (int i = 0; i < 8; i++)
+    if (lower == "fast")
     {
-      ret.push_back(0);
+      return Level::Fast;
     }
-
-    detail::Ret r = { 0, 0 };
-    uint8_t dst[24];    // 8 codes * 3 bytes maximum
-    int dstSize = 0;
-    int percent = -1;
-
-    uint32_t validBitCount = 0; //number of valid bits left in "code" byte
-    uint8_t currCodeByte = 0;
-
-    detail::Encoder state;
-
-    while (r.srcPos < src.size())
+    else if (lower == "tight")
     {
-      uint32_t numBytes;
-      uint32_t matchPos;
-      uint32_t srcPosBak;
-
-      numBytes = state.nintendoEnc(src, src.size(), r.srcPos, matchPos);
-      if (numBytes < 3)
-      {
-        //straight copy
-        dst[r.dstPos] = src[r.srcPos];
-        r.dstPos++;
-        r.srcPos++;
-        //set flag for straight copy
-        currCodeByte |= (0x80 >> validBitCount);
-      }
-      else
-      {
-        //RLE part
-        uint32_t dist = r.srcPos - matchPos - 1;
-        uint8_t byte1, byte2, byte3;
-
-        if (numBytes >= 0x12)  // 3 byte encoding
-        {
-          byte1 = 0 | (dist >> 8);
-          byte2 = dist & 0xff;
-
-          dst[r.dstPos++] = byte1;
-          dst[r.dstPos++] = byte2;
-
-          // maximum runlength for 3 byte encoding
-          if (numBytes > 0xff + 0x12)
-          {
-            numBytes = 0xff + 0x12;
-          }
-
-          byte3 = numBytes - 0x12;
-          dst[r.dstPos++] = byte3;
-        }
-        else  // 2 byte encoding
-        {
-          byte1 = ((numBytes - 2) << 4) | (dist >> 8);
-          byte2 = dist & 0xff;
-          dst[r.dstPos++] = byte1;
-          dst[r.dstPos++] = byte2;
-        }
-        r.srcPos += numBytes;
-      }
-
-      validBitCount++;
+      return Level::Tight;
+    }
 
-      //write eight codes
-      if (validBitCount == 8)
-      {
-        ret.push_back(currCodeByte);
+    throw InvalidArgumentException("Unknown compression level " + name);
+  }
 
-        for (uint32_t i = 0; i < r.dstPos; i++)
-        {
-          ret.push_back(dst[i]);
-        }
+  std::vector<uint8_t> encode(util::ByteView src, Level level)
+  {
+    return detail::encode<detail::Writer>(src, level);
+  }
 
-        dstSize += r.dstPos + 1;
+  /*
+    @return the offset of the first Yaz0 header at or after offset, or the
+            size of src if there is none.
+  */
+  static size_t find_block(util::ByteView src, size_t offset)
+  {
+    //  memmem is not available everywhere, memchr finds the candidates just as fast
+    while (src.size() >= 4 && offset <= src.size() - 4)
+    {
+      auto found = static_cast<const uint8_t*>(std::memchr(src.data() + offset, 'Y', src.size() - 3 - offset));
 
-        srcPosBak = r.srcPos;
-        currCodeByte = 0;
-        validBitCount = 0;
-        r.dstPos = 0;
-      }
-      if ((r.srcPos + 1) * 100 / src.size() != percent) 
+      if (found == nullptr)
       {
-        percent = (r.srcPos + 1) * 100 / src.size();
+        break;
       }
-    }
 
-    if (validBitCount > 0)
-    {
-      ret.push_back(currCodeByte);
+      offset = found - src.data();
 
-      for (uint32_t i = 0; i < r.dstPos; i++)
+      if (std::memcmp(found, "Yaz0", 4) == 0)
       {
-        ret.push_back(dst[i]);
+        return offset;
       }
 
-      dstSize += r.dstPos + 1;
-
-      currCodeByte = 0;
-      validBitCount = 0;
-      r.dstPos = 0;
+      offset++;
     }
 
-    return ret;
+    return src.size();
   }
 
-  std::vector<uint8_t> decode(std::vector<uint8_t>& src)
+  std::vector<uint8_t> decode(util::ByteView src)
   {
     std::vector<uint8_t> ret;
 
-    uint32_t readBytes = 0;
-
-    while (readBytes < src.size())
+    for (size_t offset = find_block(src, 0); offset + 0x10 <= src.size(); offset = find_block(src, offset))
     {
-      //search yaz0 block
-      while (readBytes + 3 < src.size() && util::read(src, readBytes, 4) != "Yaz0")
-      {
-        readBytes++;
-      }
-
-      if (readBytes + 3 >= src.size())
-      {
-        break; //nothing left to decode
-      }
-
-      readBytes += 4;
+      uint32_t size = util::read_big<uint32_t>(src, offset + 4);
+      size_t start = ret.size();
 
-      uint32_t Size = util::read_big<uint32_t>(src, readBytes);
+      //  4 byte magic, 4 byte size, 8 bytes unused
+      offset += 0x10;
+      ret.resize(start + size);
 
-      std::vector<uint8_t> dst(Size + 0x1000);
-
-      readBytes += 12; // 4 byte size, 8 byte unused
-
-      detail::Ret r = detail::decodeYaz0(&src[0] + readBytes, src.size() - readBytes, &dst[0], Size);
-      readBytes += r.srcPos;
-
-      for (uint32_t i = 0; i < r.dstPos; i++)
-      {
-        ret.push_back(dst[i]);
-      }
+      detail::Ret r = detail::decodeYaz0(src.data() + offset, src.size() - offset, ret.data() + start, size);
+      offset += r.srcPos;
     }
 
     return ret;
   }
-}
\ No newline at end of file
+}
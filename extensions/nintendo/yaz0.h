@@ -18,17 +18,32 @@
 */
 
 
+#include <algorithm>
 #include <vector>
 #include <string>
 #include <fstream>
 
 #include <cstdint>
+#include <cstring>
 
 
+#include "thread_pool.h"
 #include "util.h"
 
 namespace yaz0
 {
+  /*
+    How hard the encoder looks for matches. Fast takes the longest match
+    of a few positions and never looks ahead, for batches that write many
+    files. Tight searches the whole window and looks one byte ahead like
+    Nintendo's encoder does, for files that are kept.
+  */
+  enum Level
+  {
+    Fast,
+    Tight
+  };
+
   namespace detail
   {
     struct Ret
@@ -37,43 +52,436 @@ namespace yaz0
       uint32_t dstPos;
     };
 
-    struct EncodingState
+    uint32_t toDWORD(uint32_t d);
+
+    // simple and straight encoding scheme for Yaz0
+    uint32_t simpleEnc(util::ByteView src, uint32_t size, uint32_t pos, uint32_t& outPos);
+
+    /*
+      Brute force search of the whole window, kept as the reference the
+      hash chains are measured against.
+    */
+    class BruteForce
     {
-      EncodingState() : numBytes1(0), matchPos(0), prevFlag(0) {};
+    public:
+      BruteForce(util::ByteView src) : m_src(src) {};
 
-      uint32_t numBytes1;
-      uint32_t matchPos;
-      int prevFlag = 0;
+      inline uint32_t find(uint32_t pos, uint32_t& match)
+      {
+        return simpleEnc(m_src, m_src.size(), pos, match);
+      }
+    private:
+      util::ByteView m_src;
     };
 
-    uint32_t toDWORD(uint32_t d);
+    /*
+      Finds matches through chains of earlier positions that start with the
+      same three bytes, newest first. Positions are added as the search moves
+      forward, so every position is hashed once. Chains are cut after a
+      number of positions and at the edge of the window, which keeps each
+      search bounded no matter how repetitive the data is.
+    */
+    class HashChain
+    {
+    public:
+      static const uint32_t Window = 0x1000;
+      static const uint32_t MaxMatch = 0xFF + 0x12;
+      static const uint32_t MaxChain = 0x100;
+      static const uint32_t HashBits = 15;
 
-    // simple and straight encoding scheme for Yaz0
-    uint32_t simpleEnc(uint8_t* src, uint32_t size, uint32_t pos, uint32_t *pMatchPos);
+      /*
+        @param src - Data to encode
+        @param depth - Most positions to compare for every search
+        @param begin - First position that will be searched, only the window
+                       before it is added to the chains
+      */
+      HashChain(util::ByteView src, uint32_t depth = MaxChain, uint32_t begin = 0);
 
-    // a lookahead encoding scheme for ngc Yaz0
-    //uint32_t nintendoEnc(uint8_t* src, uint32_t size, uint32_t pos, uint32_t *pMatchPos);
+      /*
+        @param pos - Position to find a match for, never before the last one
+        @param match - Set to the start of the match when one is found
+
+        @return the length of the match, or 1 if there is none worth encoding.
+      */
+      uint32_t find(uint32_t pos, uint32_t& match);
+    private:
+      inline uint32_t hash(uint32_t pos) const
+      {
+        uint32_t key = (m_src[pos] << 16) | (m_src[pos + 1] << 8) | m_src[pos + 2];
+        return (key * 2654435761u) >> (32 - HashBits);
+      }
 
+      void insert(uint32_t pos);
 
-    class Encoder
+      util::ByteView m_src;
+      uint32_t m_depth;
+      std::vector<uint32_t> m_head;   //  Newest position + 1 for each hash, 0 for none
+      std::vector<uint32_t> m_prev;   //  Previous position + 1 with the same hash, by position in the window
+      uint32_t m_next;                //  First position that hasn't been added yet
+    };
+
+    // a lookahead encoding scheme for ngc Yaz0
+    template<typename Finder> class Encoder
     {
     public:
-      Encoder() {};
-      uint32_t nintendoEnc(const std::vector<uint8_t>& src, uint32_t size, uint32_t pos, uint32_t& pMatchPos);
+      Encoder(Finder& finder, bool lookahead) : numBytes1(0), matchPos(0), prevFlag(0), lookahead(lookahead), finder(finder) {};
+      uint32_t nintendoEnc(uint32_t pos, uint32_t& pMatchPos);
     private:
       uint32_t numBytes1;
       uint32_t matchPos;
       int prevFlag;
+      bool lookahead;
+      Finder& finder;
     };
-    
-    Ret decodeYaz0(uint8_t* src, uint32_t srcSize, uint8_t* dst, uint32_t uncompressedSize);
+
+    /*
+      Writes the header and the groups of eight codes that follow it. Every
+      group starts with a byte that has a bit set for each code that is a
+      copied byte. The output is sized for the worst case up front, where
+      every byte is copied, so codes are written in place.
+    */
+    class Writer
+    {
+    public:
+      Writer(uint32_t size);
+
+      inline void literal(uint8_t value)
+      {
+        code(true);
+        m_out[m_pos++] = value;
+      }
+
+      /*
+        @param distance - How far back the match starts, 1 to 0x1000
+        @param length - Length of the match, 3 to 0x111
+      */
+      inline void match(uint32_t distance, uint32_t length)
+      {
+        code(false);
+        distance--;
+
+        if (length >= 0x12)
+        {
+          m_out[m_pos++] = static_cast<uint8_t>(distance >> 8);
+          m_out[m_pos++] = static_cast<uint8_t>(distance);
+          m_out[m_pos++] = static_cast<uint8_t>(length - 0x12);
+        }
+        else
+        {
+          m_out[m_pos++] = static_cast<uint8_t>(((length - 2) << 4) | (distance >> 8));
+          m_out[m_pos++] = static_cast<uint8_t>(distance);
+        }
+      }
+
+      /*
+        @return the encoded data, the writer is empty afterwards.
+      */
+      std::vector<uint8_t> finish();
+    private:
+      inline void code(bool literal)
+      {
+        if (m_count == 0)
+        {
+          m_group = m_pos++;
+          m_out[m_group] = 0;
+        }
+
+        if (literal)
+        {
+          m_out[m_group] |= 0x80 >> m_count;
+        }
+
+        m_count = (m_count + 1) & 7;
+      }
+
+      std::vector<uint8_t> m_out;
+      size_t m_pos;     //  Where the next byte goes
+      size_t m_group;   //  Code byte of the current group
+      uint32_t m_count; //  Codes in the current group
+    };
+
+    template<typename Finder> uint32_t Encoder<Finder>::nintendoEnc(uint32_t pos, uint32_t& pMatchPos)
+    {
+      uint32_t numBytes = 1;
+
+      // if prevFlag is set, it means that the previous position was determined by look-ahead try.
+      // so just use it. this is not the best optimization, but nintendo's choice for speed.
+      if (prevFlag == 1)
+      {
+        pMatchPos = matchPos;
+        prevFlag = 0;
+        return numBytes1;
+      }
+
+      prevFlag = 0;
+      numBytes = finder.find(pos, matchPos);
+      pMatchPos = matchPos;
+
+      // if this position is RLE encoded, then compare to copying 1 byte and next position(pos+1) encoding
+      if (lookahead && numBytes >= 3)
+      {
+        numBytes1 = finder.find(pos + 1, matchPos);
+
+        // if the next position encoding is +2 longer than current position, choose it.
+        // this does not guarantee the best optimization, but fairly good optimization with speed.
+        if (numBytes1 >= numBytes + 2)
+        {
+          numBytes = 1;
+          prevFlag = 1;
+        }
+      }
+
+      return numBytes;
+    }
+
+    /*
+      Runs the match finder over src and writes what it finds through
+      Output, Yaz0 and Yay0 only differ in how they lay the codes out.
+
+      @param src - Data to encode
+      @param finder - Match finder over src
+      @param lookahead - Look one byte ahead before taking a match
+
+      @return src encoded by Output.
+    */
+    template<typename Output, typename Finder> std::vector<uint8_t> encode(util::ByteView src, Finder& finder, bool lookahead)
+    {
+      Output writer(src.size());
+      Encoder<Finder> state(finder, lookahead);
+
+      for (uint32_t pos = 0; pos < src.size();)
+      {
+        uint32_t matchPos = 0;
+        uint32_t numBytes = state.nintendoEnc(pos, matchPos);
+
+        if (numBytes < 3)
+        {
+          writer.literal(src[pos]);
+          pos++;
+        }
+        else
+        {
+          // maximum runlength for 3 byte encoding
+          numBytes = std::min<uint32_t>(numBytes, 0xFF + 0x12);
+
+          writer.match(pos - matchPos, numBytes);
+          pos += numBytes;
+        }
+      }
+
+      return writer.finish();
+    }
+
+    /*
+      A code of a greedy parse, a copied byte when length is 1.
+    */
+    struct Token
+    {
+      uint32_t pos;
+      uint16_t length;
+      uint16_t distance;
+    };
+
+    static const uint32_t ChunkSize = 0x100000;
+    static const uint32_t FastChain = 0x10;
+
+    /*
+      @param finder - Match finder that has not been searched past pos
+      @param pos - Position to find the code for
+
+      @return the code the greedy encoder takes at pos.
+    */
+    template<typename Finder> inline Token greedy(Finder& finder, uint32_t pos)
+    {
+      uint32_t match = 0;
+      uint32_t length = finder.find(pos, match);
+
+      if (length < 3)
+      {
+        return Token{ pos, 1, 0 };
+      }
+
+      return Token{ pos, static_cast<uint16_t>(std::min<uint32_t>(length, 0xFF + 0x12)), static_cast<uint16_t>(pos - match) };
+    }
+
+    /*
+      Greedy encoding split into chunks that are parsed on the thread pool.
+
+      The code the greedy encoder takes at a position only depends on the
+      window before it, so every chunk is parsed from its start with a
+      finder primed on the window before the chunk. The parses are then
+      joined in order. Where the last code of a chunk runs into the next
+      one, the next chunk's parse may not start where the serial one does,
+      so that part is parsed again until the two meet at the same position,
+      which is usually within a few codes. The output is the same as the
+      serial greedy encoder's.
+
+      @param src - Data to encode
+      @param depth - Most positions to compare for every search
+
+      @return src encoded by Output.
+    */
+    template<typename Output> std::vector<uint8_t> encode_chunks(util::ByteView src, uint32_t depth)
+    {
+      uint32_t size = src.size();
+      uint32_t chunks = (size + ChunkSize - 1) / ChunkSize;
+      std::vector<std::vector<Token>> parsed(chunks);
+
+      ThreadPool::shared().parallel_for(chunks, [&](uint64_t index)
+      {
+        uint32_t begin = index * ChunkSize;
+        uint32_t end = std::min(begin + ChunkSize, size);
+        HashChain finder(src, depth, begin);
+
+        for (uint32_t pos = begin; pos < end;)
+        {
+          parsed[index].push_back(greedy(finder, pos));
+          pos += parsed[index].back().length;
+        }
+      });
+
+      Output writer(size);
+      uint32_t pos = 0;
+
+      auto write = [&writer, &src](const Token& token)
+      {
+        if (token.length == 1)
+        {
+          writer.literal(src[token.pos]);
+        }
+        else
+        {
+          writer.match(token.distance, token.length);
+        }
+      };
+
+      for (auto& tokens : parsed)
+      {
+        auto token = std::lower_bound(tokens.begin(), tokens.end(), pos, [](const Token& token, uint32_t pos) { return token.pos < pos; });
+
+        if (token != tokens.end() && token->pos != pos)
+        {
+          HashChain finder(src, depth, pos);
+
+          while (token != tokens.end() && token->pos != pos)
+          {
+            Token serial = greedy(finder, pos);
+            write(serial);
+            pos += serial.length;
+
+            while (token != tokens.end() && token->pos < pos)
+            {
+              ++token;
+            }
+          }
+        }
+
+        for (; token != tokens.end(); ++token)
+        {
+          write(*token);
+          pos = token->pos + token->length;
+        }
+      }
+
+      //  The last code of the serial parse can start in the last code of the final chunk
+      if (pos < size)
+      {
+        HashChain finder(src, depth, pos);
+
+        while (pos < size)
+        {
+          Token serial = greedy(finder, pos);
+          write(serial);
+          pos += serial.length;
+        }
+      }
+
+      return writer.finish();
+    }
+
+    /*
+      @param src - Data to encode
+      @param level - How hard to look for matches
+
+      @return src encoded by Output.
+    */
+    template<typename Output> std::vector<uint8_t> encode(util::ByteView src, Level level)
+    {
+      if (level == Level::Fast)
+      {
+        if (src.size() >= 2 * ChunkSize)
+        {
+          return encode_chunks<Output>(src, FastChain);
+        }
+
+        //  Greedy over short chains
+        HashChain finder(src, FastChain);
+        return encode<Output>(src, finder, false);
+      }
+
+      //  Every position of the window can be compared, with the lookahead of Nintendo's encoder
+      HashChain finder(src, HashChain::Window);
+      return encode<Output>(src, finder, true);
+    }
+
+    /*
+      Copies a match that starts distance bytes back. When the match overlaps
+      what it writes the bytes it repeats are copied in pieces, each twice as
+      long as the last since the copied part repeats them too.
+    */
+    inline void copy_match(uint8_t* out, uint32_t distance, uint32_t length)
+    {
+      const uint8_t* from = out - distance;
+
+      if (distance >= length)
+      {
+        std::memcpy(out, from, length);
+        return;
+      }
+
+      if (distance == 1)
+      {
+        std::memset(out, *from, length);
+        return;
+      }
+
+      while (length > distance)
+      {
+        std::memcpy(out, from, distance);
+        out += distance;
+        length -= distance;
+        distance <<= 1;
+      }
+
+      std::memcpy(out, from, length);
+    }
+
+    /*
+      Decodes the codes of one block, after its header. Throws
+      InvalidRomException when the codes run past the end of the source or
+      copy from before the start of the output.
+
+      @param src - Codes of the block
+      @param srcSize - Bytes available from src
+      @param dst - Output of uncompressedSize bytes
+      @param uncompressedSize - Size from the header of the block
+
+      @return the bytes read from src and written to dst.
+    */
+    Ret decodeYaz0(const uint8_t* src, uint32_t srcSize, uint8_t* dst, uint32_t uncompressedSize);
 
   }
 
+  /*
+    @return the level with the given name, throws InvalidArgumentException
+            for unknown names.
+  */
+  Level level(const std::string& name);
+
   std::vector<uint8_t> encode(std::string filename);
   std::vector<uint8_t> decode(std::string filename);
-  std::vector<uint8_t> encode(std::vector<uint8_t>& src);
-  std::vector<uint8_t> decode(std::vector<uint8_t>& src);
+  std::vector<uint8_t> encode(util::ByteView src, Level level = Level::Tight);
+  std::vector<uint8_t> decode(util::ByteView src);
 
 
   class Decoder
@@ -0,0 +1,95 @@
+/*
+  Times the Yaz0 match finders against each other on a file and checks that
+  everything decodes back to it, and that broken Yay0 headers are rejected.
+  Built on its own with make bench:
+
+    yaz0-bench <file>
+*/
+
+#include <algorithm>
+#include <chrono>
+#include <functional>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "corruption_exceptions.h"
+#include "util.h"
+#include "yay0.h"
+#include "yaz0.h"
+
+int main(int argc, char* argv[])
+{
+  if (argc < 2)
+  {
+    std::cout << "Usage: " << argv[0] << " <file>" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  auto source = util::read_file(argv[1]);
+
+  typedef std::vector<uint8_t> (*Decoder)(util::ByteView);
+
+  auto time = [&source](std::function<std::vector<uint8_t>()> encoder, Decoder decoder, const std::string& name)
+  {
+    auto start = std::chrono::high_resolution_clock::now();
+    auto encoded = encoder();
+    auto end = std::chrono::high_resolution_clock::now();
+    auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(end - start).count();
+
+    bool valid = decoder(encoded) == source;
+
+    std::cout << name << ": " << encoded.size() << " bytes in " << elapsed / 1000.0 << "ms"
+              << (valid ? "" : " (does not decode back to the source)") << std::endl;
+
+    return std::max<long long>(elapsed, 1);
+  };
+
+  auto brute = time([&source] { yaz0::detail::BruteForce finder(source); return yaz0::detail::encode<yaz0::detail::Writer>(source, finder, true); }, yaz0::decode, "Brute force");
+  auto chain = time([&source] { yaz0::detail::HashChain finder(source); return yaz0::detail::encode<yaz0::detail::Writer>(source, finder, true); }, yaz0::decode, "Hash chain");
+  auto tight = time([&source] { return yaz0::encode(source, yaz0::Level::Tight); }, yaz0::decode, "Tight");
+  auto fast = time([&source] { return yaz0::encode(source, yaz0::Level::Fast); }, yaz0::decode, "Fast");
+
+  //  Fast splits large files into chunks encoded in parallel, which has to give the serial output
+  yaz0::detail::HashChain finder(source, yaz0::detail::FastChain);
+  bool same = yaz0::encode(source, yaz0::Level::Fast) == yaz0::detail::encode<yaz0::detail::Writer>(source, finder, false);
+  std::cout << "Fast is " << (same ? "the same as" : "different from") << " serial greedy encoding" << std::endl;
+
+  time([&source] { return yay0::encode(source, yaz0::Level::Tight); }, yay0::decode, "Yay0 tight");
+  time([&source] { return yay0::encode(source, yaz0::Level::Fast); }, yay0::decode, "Yay0 fast");
+
+  std::cout << "Speedup: " << static_cast<double>(brute) / chain << "x (hash chain), "
+            << static_cast<double>(brute) / tight << "x (tight), "
+            << static_cast<double>(brute) / fast << "x (fast)" << std::endl;
+
+  //  Link offsets near the top of the 32 bit range used to wrap the bounds check
+  bool rejected = true;
+
+  for (uint32_t link : { 0xFFFFFFFFu, 0xFFFFFFFEu })
+  {
+    std::vector<uint8_t> header = { 'Y', 'a', 'y', '0', 0, 0, 0, 0x10, 0, 0, 0, 0, 0, 0, 0, 0x14, 0, 0, 0, 0, 0, 0 };
+    uint8_t dst[0x10];
+
+    header[8] = link >> 24;
+    header[9] = (link >> 16) & 0xFF;
+    header[10] = (link >> 8) & 0xFF;
+    header[11] = link & 0xFF;
+
+    for (auto decoder : { std::function<void()>([&header] { yay0::decode(header); }),
+                          std::function<void()>([&header, &dst, link] { yay0::decodeYay0(header, link, 0x14, dst, sizeof(dst)); }) })
+    {
+      try
+      {
+        decoder();
+        rejected = false;
+      }
+      catch (const InvalidRomException&)
+      {
+      }
+    }
+  }
+
+  std::cout << "Broken Yay0 headers are " << (rejected ? "rejected" : "accepted") << std::endl;
+
+  return same && rejected ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -1,5 +1,10 @@
 #include "snes.h"
 
+#include "formats.h"
+
+//  The header moves with the mapping and a copier header, so there is no fixed magic
+static formats::Registrar format({ "SNES", "", { ".smc", ".sfc" }, {}, formats::handler<SNESCorruption>() });
+
 SNESCorruption::SNESCorruption()
 {
 
@@ -20,7 +25,8 @@ void SNESCorruption::initialize(std::string filename, std::vector<std::string>&
   // Read the rom file
   rom = util::read_file(filename);
   info = std::make_unique<CorruptionInfo>(args);
-  header = std::make_unique<SNESHeader>(rom);
+  this->keep_original(info->patch());
+  header = std::make_shared<SNESHeader>(rom);
 
   // If the rom is not valid then throw an exception
   if (!valid())
@@ -31,6 +37,11 @@ void SNESCorruption::initialize(std::string filename, std::vector<std::string>&
   // Rom is valid, set up variables.
 }
 
+void SNESCorruption::corrupt()
+{
+  corrupt_rom(SNESValidator(rom, header->offset()));
+}
+
 /*
   Determines whether or not a given byte is valid to include into the rom.
 
@@ -41,89 +52,107 @@ void SNESCorruption::initialize(std::string filename, std::vector<std::string>&
 */
 bool SNESCorruption::valid_byte(uint8_t byte, uint32_t location)
 {
-  static std::vector<uint8_t> invalid_write{ 
-  // BRK,  COP,  STP,  WAI,  REP,  SEP
-    0x00, 0x02, 0xdb, 0xcb, 0xc2, 0xe2              // Miscellaneous invalid bytes
-  };
-
-  static std::vector<uint8_t> invalid_stack{
-    0x08, 0x0B, 0x28, 0x2b, 0x48, 0x4b, 0x5a, 0x62, // Stack opcodes
-    0x68, 0x7a, 0x8b, 0xab, 0xd4, 0xda, 0xf4,       // Stack opcodes
-  };
-
-  //  Map of jump/branch opcodes and their parameter size excluding the opcode byte
-  //  std::map<opcode, param_size>
-  static std::map<uint8_t, uint8_t> invalid_branch{
-    { 0x80, 2 }, { 0x82, 3 }, { 0x30, 2 }, { 0x50, 2 }, { 0x70, 2 }, { 0x90, 2 }, { 0xb0, 2 },
-    { 0xd0, 2 }, { 0xf0, 2 }, { 0x10, 2 }, { 0x4c, 3 }, { 0x6c, 3 }, { 0xdc, 3 }, { 0x7c, 3 },
-    { 0x5c, 4 }, { 0x20, 3 }, { 0xfc, 3 }, { 0x22, 4 }, { 0x40, 1 }, { 0x60, 1 }, { 0x6b, 1 } 
-  };
+  return SNESValidator(rom, header->offset()).valid_byte(byte, location);
+}
+
+//  65c816 opcodes that need protecting and their length including the opcode byte
+static constexpr opcodes::Opcode opcode_list[] = {
+  //  BRK, COP, STP and WAI
+  { 0x00, opcodes::Forbidden, 2 }, { 0x02, opcodes::Forbidden, 2 }, { 0xdb, opcodes::Forbidden, 1 }, { 0xcb, opcodes::Forbidden, 1 },
+
+  //  REP and SEP change the size of the registers for the following instructions
+  { 0xc2, opcodes::Forbidden | opcodes::Mode, 2 }, { 0xe2, opcodes::Forbidden | opcodes::Mode, 2 },
+
+  //  Stack opcodes
+  { 0x08, opcodes::Stack, 1 }, { 0x0b, opcodes::Stack, 1 }, { 0x28, opcodes::Stack, 1 }, { 0x2b, opcodes::Stack, 1 },
+  { 0x48, opcodes::Stack, 1 }, { 0x4b, opcodes::Stack, 1 }, { 0x5a, opcodes::Stack, 1 }, { 0x62, opcodes::Stack, 3 },
+  { 0x68, opcodes::Stack, 1 }, { 0x7a, opcodes::Stack, 1 }, { 0x8b, opcodes::Stack, 1 }, { 0xab, opcodes::Stack, 1 },
+  { 0xd4, opcodes::Stack, 2 }, { 0xda, opcodes::Stack, 1 }, { 0xf4, opcodes::Stack, 3 },
+
+  //  Jump and branch opcodes
+  { 0x80, opcodes::Branch, 2 }, { 0x82, opcodes::Branch, 3 }, { 0x30, opcodes::Branch, 2 }, { 0x50, opcodes::Branch, 2 },
+  { 0x70, opcodes::Branch, 2 }, { 0x90, opcodes::Branch, 2 }, { 0xb0, opcodes::Branch, 2 }, { 0xd0, opcodes::Branch, 2 },
+  { 0xf0, opcodes::Branch, 2 }, { 0x10, opcodes::Branch, 2 }, { 0x4c, opcodes::Branch, 3 }, { 0x6c, opcodes::Branch, 3 },
+  { 0xdc, opcodes::Branch, 3 }, { 0x7c, opcodes::Branch, 3 }, { 0x5c, opcodes::Branch, 4 }, { 0x20, opcodes::Branch, 3 },
+  { 0xfc, opcodes::Branch, 3 }, { 0x22, opcodes::Branch, 4 },
+
+  //  RTI, RTS and RTL
+  { 0x40, opcodes::Return, 1 }, { 0x60, opcodes::Return, 1 }, { 0x6b, opcodes::Return, 1 },
 
   //  STA $xxxx (, *) opcodes
-  static std::vector<uint8_t> sta_ops{ 0x8D, 0x99, 0x9D };
+  { 0x8d, opcodes::LoadStore, 3 }, { 0x99, opcodes::LoadStore, 3 }, { 0x9d, opcodes::LoadStore, 3 }
+};
 
-  //  If the location points to the SNES header then it is invalid
-  if (location >= this->header->offset() && location <= this->header->offset() + SNESHeader::Header_Size)
+static constexpr opcodes::Table opcode_table = opcodes::make_table(opcode_list);
+
+/*
+  Determines whether a byte value can be written anywhere in the rom.
+
+  @param byte - The byte that needs to be checked
+
+  @return true if the byte is not an opcode that halts or changes the CPU mode.
+*/
+bool SNESValidator::valid_value(uint8_t byte)
+{
+  return !opcode_table.is(byte, opcodes::Forbidden);
+}
+
+/*
+  Determines whether a location in the rom is part of the header or of an
+  instruction that is not safe to modify.
+
+  @param location - The offset in the rom
+
+  @return true if nothing may be written at @location.
+*/
+bool SNESValidator::protected_location(uint32_t location) const
+{
+  if (location >= this->rom.size())
   {
-    return false;
+    return true;
   }
 
-  if (std::find(invalid_write.begin(), invalid_write.end(), byte) != invalid_write.end())
+  //  If the location points to the SNES header then it is invalid
+  if (location >= this->header_offset && location <= this->header_offset + SNESHeader::Header_Size)
   {
-    //  Given byte value is invalid for any space
-    return false;
+    return true;
   }
 
-  //  Check special case of REP (0xc2) and SEP (0xe2) opcodes which cannot
-  //  have their opcode or parameter modified safely.
-  if (this->rom[location - 1] == 0xc2 || this->rom[location - 1] == 0xe2)
+  const uint8_t* data = &this->rom[0];
+
+  //  REP (0xc2) and SEP (0xe2) cannot have their opcode or parameter modified safely.
+  if (location > 0 && opcode_table.is(data[location - 1], opcodes::Mode))
   {
-    return false;
+    return true;
   }
 
-  if (std::find(invalid_stack.begin(), invalid_stack.end(), this->rom[location]) != invalid_stack.end())
+  //  Byte at overwrite location is a stack opcode
+  if (opcode_table.is(data[location], opcodes::Stack))
   {
-    //  Byte at overwrite location contains an important value.
-    return false;
+    return true;
   }
 
-  //  Iterate over each jump/branch instruction pair
-  for (auto& pair : invalid_branch)
+  //  Location is a jump/branch/return opcode or one of its parameters
+  if (opcode_table.covers(data, location, opcodes::Branch | opcodes::Return))
   {
-    //  For readabiity, assign branch pair values to locals
-    uint8_t opcode = pair.first;  //  Branch opcode
-    uint8_t param = pair.second;  //  Branch parameter size
-
-    for (int i = 0; i < param; i++)
-    {
-      //  If this part of rom contains a branch opcode return false
-      if (this->rom[location - i] == opcode)
-      {
-        return false;
-      }
-    }
+    return true;
   }
 
-  //  Check for STA commands
-  for (auto& sta : sta_ops)
+  //  Check for STA commands, all of them are 3 bytes long so check back 2 bytes max
+  for (uint32_t i = 0; i < 3 && i <= location; i++)
   {
-    //  All 3 are 3 bytes long, so check back 2 bytes max
-    for (int i = 0; i < 3; i++)
+    if (opcode_table.is(data[location - i], opcodes::LoadStore) && location - i + 1 < this->rom.size())
     {
-      //  Check if given location has a STA opcode
-      if (this->rom[location - i] == sta)
+      //  If opcode is found, determine whether or not it contains an important register value
+      if (SNESValidator::is_register(util::read<uint16_t>(rom, location - i)))
       {
-        //  If opcode is found, determine whether or not it contains an important register value
-        if (SNESCorruption::is_register(util::read<uint16_t>(ref(rom), location - i)))
-        {
-          //  If it contains an important register then it isn't safe to overwrite.
-          return false;
-        }
+        //  If it contains an important register then it isn't safe to overwrite.
+        return true;
       }
     }
   }
 
-  return true;
+  return false;
 }
 
 /*
@@ -189,13 +218,11 @@ void SNESCorruption::save(std::string filename)
   {
     if (info->save_file() != "")
     {
-      util::write_file(info->save_file(), rom);
-      this->save_name = info->save_file();
+      this->save_name = this->write_rom(info->save_file(), info->patch());
     }
     else
     {
-      util::write_file(filename, rom);
-      this->save_name = filename;
+      this->save_name = this->write_rom(filename, info->patch());
     }
   }
   catch (InvalidFileNameException e)
@@ -204,3 +231,20 @@ void SNESCorruption::save(std::string filename)
     exit(EXIT_FAILURE);
   }
 }
+
+/*
+  Makes a new corruption of this rom sharing its header and protections.
+
+  @param args - Arguments of the new corruption
+*/
+std::unique_ptr<Corruption> SNESCorruption::variant(std::vector<std::string>& args)
+{
+  auto copy = std::make_unique<SNESCorruption>();
+
+  copy->share(*this);
+  copy->header = this->header;
+  copy->info = std::make_unique<CorruptionInfo>(args);
+  copy->keep_original(copy->info->patch());
+
+  return copy;
+}
@@ -42,6 +42,7 @@
 
 */
 #include "corrupt.h"
+#include "opcodes.h"
 #include "snes_except.h"
 #include "snes_header.h"
 
@@ -53,6 +54,30 @@
 
 #include "util.h"
 
+/*
+  Opcode protections for SNES roms. This is kept separate from SNESCorruption
+  so that the corruption engine can inline it.
+*/
+class SNESValidator : public engine::Validator<SNESValidator>
+{
+public:
+  SNESValidator(util::ByteView rom, uint32_t header_offset) : rom(rom), header_offset(header_offset) {};
+
+  inline bool valid_byte(uint8_t byte, uint32_t location) const
+  {
+    return valid_value(byte) && !protected_location(location);
+  }
+
+  bool protected_location(uint32_t location) const;
+  static bool valid_value(uint8_t byte);
+
+private:
+  util::ByteView rom;
+  uint32_t header_offset;
+
+  static bool is_register(uint16_t value);
+};
+
 class SNESCorruption : public Corruption
 {
 public:
@@ -60,16 +85,17 @@ public:
   SNESCorruption(std::string filename, std::vector<std::string>& args);
   ~SNESCorruption();
 
+  virtual void corrupt();
   virtual void initialize(std::string filename, std::vector<std::string>& args);
   virtual bool valid();
   virtual bool valid_byte(uint8_t byte, uint32_t location);
   virtual void print_header();
   virtual void save(std::string filename);
 
-private:
-  std::unique_ptr<SNESHeader> header;
+  virtual std::unique_ptr<Corruption> variant(std::vector<std::string>& args);
 
-  static bool is_register(uint16_t value);
+private:
+  std::shared_ptr<SNESHeader> header;
 };
 
 
@@ -82,7 +108,7 @@ write operations in this list: http://wiki.superfamicom.org/snes/show/Registers
 
 @return true if value is an SNES register.
 */
-inline bool SNESCorruption::is_register(uint16_t addr)
+inline bool SNESValidator::is_register(uint16_t addr)
 {
   //  There are over 200 different registers in the SNES but it is possible to represent all of them
   //  using generalized bitwise compares instead of writing out every one of them. On top of not
@@ -5,7 +5,7 @@ SNESHeader::SNESHeader()
   //  Do nothing
 }
 
-SNESHeader::SNESHeader(std::vector<uint8_t>& rom)
+SNESHeader::SNESHeader(util::ByteView rom)
 {
   this->initialize(rom);
 }
@@ -15,7 +15,7 @@ SNESHeader::~SNESHeader()
   //  Do nothing
 }
 
-void SNESHeader::initialize(std::vector<uint8_t>& rom)
+void SNESHeader::initialize(util::ByteView rom)
 {
   // If the rom size divided by 0x2000 has a remainder of 0x200 (512)
   // Then the rom has a 512 byte smc header.
@@ -119,7 +119,7 @@ uint32_t SNESHeader::offset()
 
   @return A score of how likely the given address is to be the SNES header. Higher values mean it's more likely.
 */
-uint32_t SNESHeader::score_header(std::vector<uint8_t> &rom, uint32_t address)
+uint32_t SNESHeader::score_header(util::ByteView rom, uint32_t address)
 {
   //  If the given address + header size exceeds the rom size then it can't possibly be a header.
   if (address + SNESHeader::Header_Size > rom.size())
@@ -225,7 +225,7 @@ uint32_t SNESHeader::begin()
   return offset;
 }
 
-inline uint16_t SNESHeader::create_uint16(std::vector<uint8_t> &rom, uint32_t address)
+inline uint16_t SNESHeader::create_uint16(util::ByteView rom, uint32_t address)
 {
   uint16_t value = rom[address] | (rom[address + 1] << 8);
   return value;
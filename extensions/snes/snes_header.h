@@ -11,6 +11,7 @@
 #include <cstdint>
 
 #include "snes_except.h"
+#include "util.h"
 
 
 namespace SNESOffset
@@ -47,10 +48,10 @@ struct SNESHeader
   static const int Header_Size = 64;
 
   SNESHeader();
-  SNESHeader(std::vector<uint8_t> &rom);
+  SNESHeader(util::ByteView rom);
   ~SNESHeader();
 
-  void initialize(std::vector<uint8_t>&);
+  void initialize(util::ByteView);
 
   bool smc_header();
 
@@ -73,8 +74,8 @@ private:
   bool has_smc;
   uint32_t header_offset;
 
-  static uint32_t score_header(std::vector<uint8_t>& rom, uint32_t address);
-  static inline uint16_t create_uint16(std::vector<uint8_t>& rom, uint32_t address);
+  static uint32_t score_header(util::ByteView rom, uint32_t address);
+  static inline uint16_t create_uint16(util::ByteView rom, uint32_t address);
 };
 
 #endif
@@ -0,0 +1,187 @@
+#include "formats.h"
+
+#include <algorithm>
+#include <cctype>
+
+#include "rng.h"
+#include "util.h"
+
+namespace formats
+{
+  static std::string lowercase(std::string text)
+  {
+    std::transform(text.begin(), text.end(), text.begin(), [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+    return text;
+  }
+
+  Registry& Registry::shared()
+  {
+    static Registry registry;
+    return registry;
+  }
+
+  void Registry::add(Format format)
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    m_formats.push_back(std::move(format));
+    const Format* added = &m_formats.back();
+
+    if (added->flag != "")
+    {
+      m_flags.insert(std::make_pair(added->flag, added));
+    }
+
+    for (auto& extension : added->extensions)
+    {
+      m_extensions.insert(std::make_pair(lowercase(extension), added));
+    }
+
+    for (auto& signature : added->signatures)
+    {
+      m_signatures.insert(std::make_pair((static_cast<uint64_t>(signature.offset) << 32) | signature.magic, added));
+
+      if (std::find(m_offsets.begin(), m_offsets.end(), signature.offset) == m_offsets.end())
+      {
+        m_offsets.insert(std::upper_bound(m_offsets.begin(), m_offsets.end(), signature.offset), signature.offset);
+      }
+
+      m_probe_size = std::max(m_probe_size, signature.offset + 4);
+    }
+  }
+
+  const Format* Registry::detect(const std::string& filename, std::vector<std::string>& args)
+  {
+    uint32_t probe_size;
+
+    {
+      std::lock_guard<std::mutex> lock(m_mutex);
+
+      for (auto& arg : args)
+      {
+        auto flag = m_flags.find(arg);
+
+        if (flag != m_flags.end())
+        {
+          args.erase(std::remove(args.begin(), args.end(), flag->first), args.end());
+          return flag->second;
+        }
+      }
+
+      probe_size = m_probe_size;
+    }
+
+    //  Only the start of the file is read, the furthest signature decides how much.
+    //  It is read without the lock so batch lines don't wait on each other's files.
+    auto head = util::read_file(filename, probe_size);
+    util::ByteView probe(head);
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    for (uint32_t offset : m_offsets)
+    {
+      if (offset + 4 > probe.size())
+      {
+        break;
+      }
+
+      auto found = m_signatures.find((static_cast<uint64_t>(offset) << 32) | probe.read_big<uint32_t>(offset));
+
+      if (found != m_signatures.end())
+      {
+        return found->second;
+      }
+    }
+
+    auto extension = m_extensions.find(lowercase(boost::filesystem::extension(filename)));
+
+    if (extension != m_extensions.end())
+    {
+      return extension->second;
+    }
+
+    return nullptr;
+  }
+
+  bool Registry::known_extension(std::string extension)
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_extensions.find(lowercase(extension)) != m_extensions.end();
+  }
+
+  std::vector<std::vector<std::string>> variants(std::vector<std::string> args)
+  {
+    uint32_t count = 1;
+    auto flag = std::find(args.begin(), args.end(), "--variants");
+
+    if (flag != args.end() && flag + 1 != args.end())
+    {
+      count = std::max(1u, util::to_int32(*(flag + 1)));
+      args.erase(flag, flag + 2);
+    }
+
+    //  Values that name files are never split
+    static const std::vector<std::string> file_flags = { "-f", "--files", "--filelist", "-o", "--out" };
+
+    std::vector<std::vector<std::string>> grid = { args };
+
+    for (uint32_t i = 1; i < args.size(); i++)
+    {
+      if (args[i].find(',') == std::string::npos || args[i - 1][0] != '-' ||
+          std::find(file_flags.begin(), file_flags.end(), args[i - 1]) != file_flags.end())
+      {
+        continue;
+      }
+
+      std::vector<std::vector<std::string>> expanded;
+
+      for (auto& point : grid)
+      {
+        for (auto& value : util::split(args[i], ",", false))
+        {
+          expanded.push_back(point);
+          expanded.back()[i] = value;
+        }
+      }
+
+      grid = expanded;
+    }
+
+    if (grid.size() == 1 && count == 1)
+    {
+      return grid;
+    }
+
+    std::vector<std::vector<std::string>> result;
+    auto seed = std::find(args.begin(), args.end(), "--seed") - args.begin();
+    auto out = std::find_if(args.begin(), args.end(), [](const std::string& arg) { return arg == "-o" || arg == "--out"; }) - args.begin();
+    uint64_t base = util::to_int64(args[seed + 1]);
+
+    for (auto& point : grid)
+    {
+      for (uint32_t i = 0; i < count; i++)
+      {
+        uint32_t index = result.size();
+        result.push_back(point);
+
+        //  Each of the N variants gets its own seed, shared by every combination of values
+        //  so the combinations can be compared with each other
+        if (count > 1)
+        {
+          result.back()[seed + 1] = std::to_string(rng::derive(base, i));
+        }
+
+        if (out + 1 < static_cast<std::ptrdiff_t>(args.size()))
+        {
+          boost::filesystem::path path(args[out + 1]);
+          path.replace_extension();
+          result.back()[out + 1] = path.string() + "_" + std::to_string(index) + boost::filesystem::extension(args[out + 1]);
+        }
+
+        std::cout << "Variant " << index << " Seed: " << result.back()[seed + 1] << std::endl;
+      }
+    }
+
+    return result;
+  }
+}
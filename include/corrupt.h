@@ -5,13 +5,15 @@
 
 #include "corruption_exceptions.h"
 #include "corruptioninfo.h"
+#include "engine.h"
+#include "patch.h"
+#include "protection.h"
 
 #include <ctime>
 #include <cstdint>
 #include <cstdlib>
 
 #include <limits>
-#include <random>
 #include <vector>
 #include <fstream>
 #include <iterator>
@@ -32,7 +34,11 @@ public:
   virtual void corrupt();
   virtual void save(std::string filename);
 
-  virtual int size();
+  virtual std::unique_ptr<Corruption> variant(std::vector<std::string>& args);
+
+  std::string default_name();
+
+  virtual uint64_t size();
 
   virtual void initialize(std::string filename, std::vector<std::string>& args);
   virtual void print_header();
@@ -40,19 +46,53 @@ public:
   virtual bool valid_byte(uint8_t byte, uint32_t location);
   virtual void run();
 protected:
+  template<typename V> void corrupt_rom(const engine::Validator<V>& validator);
+
+  void share(const Corruption& other);
+  void keep_original(patch::Format format);
+  std::string write_rom(std::string filename, patch::Format format);
+  std::string write_mapped(std::string filename, patch::Format format);
+  std::string write_image(std::string filename, const std::string& source, patch::Format format);
+
   //  Holds the raw rom data
   std::vector<uint8_t> rom;
+  //  Files without a format are mapped instead of read into rom, so large images only load the pages they touch
+  std::unique_ptr<util::MappedFile> image;
+  //  Part of the image that the corruption may have changed
+  engine::Range dirty;
+  //  The rom as it was loaded, only kept when saving a patch
+  std::vector<uint8_t> original;
+  //  Edits for the patch when they aren't made to rom
+  patch::Recorder edits;
   //  fstream for reading and writing to files
   std::fstream rom_file;
   //  Last save name for running/opening the file
   std::string save_name;
-
-  std::random_device rd;
-  std::mt19937 random;
+  //  Base name of the loaded file, saved to when no output file is given
+  std::string name;
 
   std::unique_ptr<CorruptionInfo> info;
+
+  //  Protected offsets of the rom, analyzed on the first corruption and shared with variants
+  std::shared_ptr<engine::ProtectionMap> protection;
 };
 
+/*
+  Runs the corruption engine over the whole rom with the given protections.
+  The validator is only run once over the original rom, every corruption
+  after that uses the precomputed protection map.
+
+  @param validator - Protection policy for the rom
+*/
+template<typename V> void Corruption::corrupt_rom(const engine::Validator<V>& validator)
+{
+  this->protection->analyze_once(this->rom.size(), validator);
+
+  uint64_t corruptions = engine::corrupt(this->rom, engine::Options(*info), *this->protection, info->seed());
+
+  std::cout << "Replaced a total of " << corruptions << " bytes." << std::endl;
+}
+
 // Add new Corruption class headers here
 #include "nes/nes.h"
 #include "snes/snes.h"
@@ -7,6 +7,8 @@
 #include <limits>
 #include <vector>
 
+#include "patch.h"
+#include "rng.h"
 #include "util.h"
 
 enum CorruptionType
@@ -39,8 +41,10 @@ public:
   CorruptionType type();
   uint32_t value();
   uint32_t step();
-  uint32_t start();
-  uint32_t end();
+  uint64_t start();
+  uint64_t end();
+  uint64_t seed();
+  patch::Format patch();
   bool list();
 protected:
   std::string m_outfile;  //  Output file path
@@ -48,10 +52,14 @@ protected:
 
   //  Basic information
   uint32_t m_step;
-  uint32_t m_start;
-  uint32_t m_end;
+  uint64_t m_start;
+  uint64_t m_end;
   uint32_t m_value;
 
+  uint64_t m_seed;  //  Seed for random corruptions
+
+  patch::Format m_patch;  //  Save a patch instead of the corrupted file
+
   bool m_list;  //  Listing file contents (JSON)
 
   //  Files to corrupt if files are implemented
@@ -93,16 +101,26 @@ inline uint32_t CorruptionInfo::step()
   return m_step;
 }
 
-inline uint32_t CorruptionInfo::start()
+inline uint64_t CorruptionInfo::start()
 {
   return m_start;
 }
 
-inline uint32_t CorruptionInfo::end()
+inline uint64_t CorruptionInfo::end()
 {
   return m_end;
 }
 
+inline uint64_t CorruptionInfo::seed()
+{
+  return m_seed;
+}
+
+inline patch::Format CorruptionInfo::patch()
+{
+  return m_patch;
+}
+
 inline bool CorruptionInfo::list()
 {
   return m_list;
@@ -0,0 +1,561 @@
+#ifndef _CORRUPTION_ENGINE_H
+#define _CORRUPTION_ENGINE_H
+
+/*
+  The corruption engine is the single loop that every backend runs its
+  corruptions through. It used to be copied into each backend as a chain
+  of if/else blocks that tested the corruption type and called a virtual
+  valid_byte for every byte in the range.
+
+  The engine is templated on the CorruptionType so the operation is picked
+  once per run instead of once per byte, and on a validator policy so the
+  protection check is a regular (inlinable) call.
+
+  Validators use CRTP: derive from engine::Validator<T> and provide
+
+    bool valid_byte(uint8_t byte, uint32_t location) const;
+
+  where location is the offset into the buffer being corrupted. Validators
+  that know every value a location allows can also provide
+
+    bool allowed_values(uint32_t location, Values& values) const;
+
+  which lets Random pick from the allowed values directly instead of
+  drawing until valid_byte accepts one.
+
+  Validators that can be precomputed into a ProtectionMap (protection.h)
+  split the check into the parts that only depend on the location or the
+  value:
+
+    bool protected_location(uint32_t location) const;
+    static bool valid_value(uint8_t byte);
+
+  and, when valid_value only applies to part of the data,
+
+    uint32_t values_end() const;
+
+  past which every value is allowed.
+
+  The range is split into fixed size chunks which run on the shared thread
+  pool when the validator doesn't read the buffer (Precomputed). Each chunk
+  draws from its own counter based generator keyed by the seed and the
+  chunk index, and Shift reads the bytes other chunks write from a copy
+  made before they run, so the output only depends on the seed and never
+  on the thread count. Swap pairs every offset with at most one other, so
+  swaps never touch the same bytes and the result is always a
+  rearrangement of the original bytes.
+*/
+
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+#include "corruptioninfo.h"
+#include "rng.h"
+#include "simd.h"
+#include "thread_pool.h"
+#include "util.h"
+
+namespace engine
+{
+  struct Options
+  {
+    Options() : type(CorruptionType::None), value(0), start(0), end(0), step(0) {};
+    Options(CorruptionType type, uint32_t value, uint64_t start, uint64_t end, uint32_t step)
+      : type(type), value(value), start(start), end(end), step(step) {};
+    explicit Options(CorruptionInfo& info)
+      : type(info.type()), value(info.value()), start(info.start()), end(info.end()), step(info.step()) {};
+
+    CorruptionType type;  //  Operation to apply
+    uint32_t value;       //  Operand of the operation
+    uint64_t start;       //  First offset to corrupt
+    uint64_t end;         //  Offsets at or past this value are not corrupted
+    uint32_t step;        //  Distance between each corrupted offset
+  };
+
+  /*
+    A set of byte values, one bit per value.
+  */
+  struct Values
+  {
+    uint64_t words[4];
+
+    inline uint32_t count() const
+    {
+      return util::popcount(words[0]) + util::popcount(words[1]) + util::popcount(words[2]) + util::popcount(words[3]);
+    }
+
+    /*
+      @param n - Index of the value to get, must be less than count()
+
+      @return the nth value of the set in increasing order.
+    */
+    inline uint8_t select(uint32_t n) const
+    {
+      uint32_t word = 0;
+
+      for (uint32_t count = util::popcount(words[word]); n >= count; count = util::popcount(words[++word]))
+      {
+        n -= count;
+      }
+
+      return static_cast<uint8_t>(word * 64 + util::select(words[word], n));
+    }
+  };
+
+  template<typename Derived> class Validator
+  {
+  public:
+    inline bool valid(uint8_t byte, uint32_t location) const
+    {
+      return static_cast<const Derived*>(this)->valid_byte(byte, location);
+    }
+
+    inline bool protects(uint32_t location) const
+    {
+      return static_cast<const Derived*>(this)->protected_location(location);
+    }
+
+    inline bool allows(uint8_t byte) const
+    {
+      return static_cast<const Derived*>(this)->valid_value(byte);
+    }
+
+    inline bool values(uint32_t location, Values& values) const
+    {
+      return static_cast<const Derived*>(this)->allowed_values(location, values);
+    }
+
+    inline uint32_t values_limit() const
+    {
+      return static_cast<const Derived*>(this)->values_end();
+    }
+
+    //  Defaults for validators that only check one of the two
+    inline bool protected_location(uint32_t location) const { return false; }
+    static inline bool valid_value(uint8_t byte) { return true; }
+    inline uint32_t values_end() const { return std::numeric_limits<uint32_t>::max(); }
+
+    //  By default the allowed values are unknown and Random has to test them
+    inline bool allowed_values(uint32_t location, Values& values) const { return false; }
+
+    //  Validators that never read the buffer being corrupted set this. They
+    //  can be checked from any thread, and by the vector kernels on their own
+    //  through protection().
+    static const bool Precomputed = false;
+    inline simd::Protection protection() const { return simd::Protection(); }
+  };
+
+  /*
+    Validator for data that has no protections.
+  */
+  class Unprotected : public Validator<Unprotected>
+  {
+  public:
+    static const bool Precomputed = true;
+
+    inline bool valid_byte(uint8_t byte, uint32_t location) const
+    {
+      return true;
+    }
+
+    inline bool allowed_values(uint32_t location, Values& values) const
+    {
+      std::fill(values.words, values.words + 4, ~0ull);
+      return true;
+    }
+  };
+
+  /*
+    Byte transforms for the operations which only depend on the current
+    byte and the corruption value.
+  */
+  template<CorruptionType Type> struct Operation;
+
+  template<> struct Operation<CorruptionType::Add>
+  {
+    static inline uint8_t apply(uint8_t byte, uint32_t value) { return byte + value; }
+  };
+
+  template<> struct Operation<CorruptionType::Set>
+  {
+    static inline uint8_t apply(uint8_t byte, uint32_t value) { return value; }
+  };
+
+  template<> struct Operation<CorruptionType::RotateLeft>
+  {
+    static inline uint8_t apply(uint8_t byte, uint32_t value) { return util::rol<uint8_t>(byte, value); }
+  };
+
+  template<> struct Operation<CorruptionType::RotateRight>
+  {
+    static inline uint8_t apply(uint8_t byte, uint32_t value) { return util::ror<uint8_t>(byte, value); }
+  };
+
+  template<> struct Operation<CorruptionType::LogicalAnd>
+  {
+    static inline uint8_t apply(uint8_t byte, uint32_t value) { return byte & value; }
+  };
+
+  template<> struct Operation<CorruptionType::LogicalOr>
+  {
+    static inline uint8_t apply(uint8_t byte, uint32_t value) { return byte | value; }
+  };
+
+  template<> struct Operation<CorruptionType::LogicalXor>
+  {
+    static inline uint8_t apply(uint8_t byte, uint32_t value) { return byte ^ value; }
+  };
+
+  template<> struct Operation<CorruptionType::LogicalComplement>
+  {
+    static inline uint8_t apply(uint8_t byte, uint32_t value) { return ~byte; }
+  };
+
+  namespace detail
+  {
+    //  Amount of bytes of the range handled by a single chunk
+    static const uint32_t Chunk_Size = 0x40000;
+
+    //  Most bytes Shift copies from after the chunks when they run at once
+    static const uint64_t Max_Tails = 0x4000000;
+
+    /*
+      The data Shift reads from. Offsets are the same as the buffer being
+      corrupted. A chunk only writes offsets it has already read past, so
+      everything before the end of the chunk is read from the buffer. The
+      offsets after it belong to later chunks, which may be writing them at
+      the same time, so those are read from a copy made before any chunk ran.
+    */
+    struct Source
+    {
+      const uint8_t* bytes;
+      uint64_t last;        //  Offsets at or past this are read from tail
+      const uint8_t* tail;  //  Copy of the value bytes after the chunk, nullptr when chunks run in order
+
+      inline uint8_t operator[](uint64_t location) const
+      {
+        return location < last || tail == nullptr ? bytes[location] : tail[location - last];
+      }
+    };
+
+    /*
+      Part of the range handled by one chunk.
+    */
+    struct Chunk
+    {
+      uint64_t start; //  Start of the whole range
+      uint64_t first; //  First offset to corrupt, always on the stride
+      uint64_t last;  //  Offsets at or past this are handled by later chunks
+      uint64_t end;   //  End of the whole range
+      uint64_t size;  //  Size of the buffer
+    };
+
+    /*
+      A single pass over a chunk for one operation. The general case covers
+      every operation that has an Operation<Type> transform; Shift, Swap and
+      Random read from other places and are specialized below.
+
+      Validators the vector kernels understand are handed to them first.
+    */
+    template<CorruptionType Type> struct Pass
+    {
+      template<typename V>
+      static uint64_t run(uint8_t* data, const Source& source, const Chunk& chunk, const Options& options, const Validator<V>& validator, rng::Counter& random)
+      {
+        uint64_t corruptions = 0;
+
+        if (V::Precomputed &&
+            simd::transform(Type, options.value, data, chunk.first, chunk.last, options.step,
+                            static_cast<const V&>(validator).protection(), corruptions))
+        {
+          return corruptions;
+        }
+
+        for (uint64_t i = chunk.first; i < chunk.last; i += options.step)
+        {
+          uint8_t byte = Operation<Type>::apply(data[i], options.value);
+
+          if (validator.valid(byte, i))
+          {
+            data[i] = byte;
+            corruptions++;
+          }
+        }
+
+        return corruptions;
+      }
+    };
+
+    template<> struct Pass<CorruptionType::Shift>
+    {
+      template<typename V>
+      static uint64_t run(uint8_t* data, const Source& source, const Chunk& chunk, const Options& options, const Validator<V>& validator, rng::Counter& random)
+      {
+        uint64_t corruptions = 0;
+        for (uint64_t i = chunk.first; i < chunk.last; i += options.step)
+        {
+          //  If it's okay to put the other byte in this position then change it
+          if (i + options.value < chunk.size && validator.valid(source[i + options.value], i))
+          {
+            data[i] = source[i + options.value];
+            corruptions++;
+          }
+        }
+
+        return corruptions;
+      }
+    };
+
+    template<> struct Pass<CorruptionType::Swap>
+    {
+      template<typename V>
+      static uint64_t run(uint8_t* data, const Source& source, const Chunk& chunk, const Options& options, const Validator<V>& validator, rng::Counter& random)
+      {
+        uint64_t corruptions = 0;
+
+        if (options.value == 0)
+        {
+          return 0;
+        }
+
+        //  A partner on the stride would also start a swap of its own. Offsets
+        //  are paired up in runs of value / step instead, the first run of a
+        //  pair swaps with the second, so every offset is in at most one swap
+        //  and each swap only touches its own two bytes.
+        uint64_t run_length = options.value % options.step == 0 ? options.value / options.step : 0;
+
+        for (uint64_t i = chunk.first; i < chunk.last; i += options.step)
+        {
+          uint64_t other = i + options.value;
+
+          if (run_length != 0 && ((i - chunk.start) / options.step / run_length) % 2 != 0)
+          {
+            continue;
+          }
+
+          uint8_t byte = data[i];
+          uint8_t partner = other < chunk.size ? data[other] : 0;
+
+          if (other < chunk.size &&
+            validator.valid(partner, i) &&  //  If it's okay to put the other byte in this position
+            validator.valid(byte, other))   //  And it's okay to put this byte in the other position
+          {
+            data[i] = partner;
+            data[other] = byte;
+            corruptions++;
+          }
+        }
+
+        return corruptions;
+      }
+    };
+
+    template<> struct Pass<CorruptionType::Random>
+    {
+      template<typename V>
+      static uint64_t run(uint8_t* data, const Source& source, const Chunk& chunk, const Options& options, const Validator<V>& validator, rng::Counter& random)
+      {
+        uint64_t corruptions = 0;
+        Values values;
+
+        for (uint64_t i = chunk.first; i < chunk.last; i += options.step)
+        {
+          //  Pick uniformly from the values the location allows
+          if (validator.values(i, values))
+          {
+            uint32_t count = values.count();
+
+            if (count > 0)
+            {
+              data[i] = values.select(static_cast<uint32_t>(((random() >> 32) * count) >> 32));
+              corruptions++;
+            }
+
+            continue;
+          }
+
+          //  Try up to 100 times to corrupt
+          for (uint32_t retry = 0; retry < 100; retry++)
+          {
+            uint8_t rand = random.byte();
+
+            if (validator.valid(rand, i))
+            {
+              data[i] = rand;
+              corruptions++;
+              break;
+            }
+          }
+        }
+
+        return corruptions;
+      }
+    };
+
+    /*
+      Splits the range into chunks and runs a pass over every one of them.
+    */
+    template<CorruptionType Type, typename V>
+    uint64_t run(uint8_t* data, uint64_t size, const Options& options, const Validator<V>& validator, uint64_t seed)
+    {
+      uint64_t end = std::min<uint64_t>(size, options.end);
+
+      if (options.start >= end)
+      {
+        return 0;
+      }
+
+      //  Chunks hold a whole number of steps so every chunk starts on the stride
+      uint64_t span = std::max<uint64_t>(1, Chunk_Size / options.step) * options.step;
+      uint64_t chunks = (end - options.start + span - 1) / span;
+      bool parallel = V::Precomputed && chunks > 1;
+
+      //  Shift reads up to value bytes past its chunk, which the chunks after it
+      //  write. Those bytes are copied for every chunk when they run at once,
+      //  and a value so large that the copies would be too big runs in order.
+      std::vector<std::vector<uint8_t>> tails;
+
+      if (Type == CorruptionType::Shift && parallel)
+      {
+        if (chunks * options.value > Max_Tails)
+        {
+          parallel = false;
+        }
+        else
+        {
+          tails.resize(chunks);
+
+          for (uint64_t index = 0; index < chunks; index++)
+          {
+            uint64_t last = std::min(end, options.start + (index + 1) * span);
+            tails[index].assign(data + last, data + std::min<uint64_t>(size, last + options.value));
+          }
+        }
+      }
+
+      std::vector<uint64_t> corruptions(chunks, 0);
+
+      auto body = [&](uint64_t index)
+      {
+        Chunk chunk;
+        chunk.start = options.start;
+        chunk.first = options.start + index * span;
+        chunk.last = std::min(end, chunk.first + span);
+        chunk.end = end;
+        chunk.size = size;
+
+        Source source = { data, chunk.last, tails.empty() ? nullptr : tails[index].data() };
+
+        rng::Counter random(seed, index);
+        corruptions[index] = Pass<Type>::run(data, source, chunk, options, validator, random);
+      };
+
+      if (parallel)
+      {
+        ThreadPool::shared().parallel_for(chunks, body);
+      }
+      else
+      {
+        for (uint64_t i = 0; i < chunks; i++)
+        {
+          body(i);
+        }
+      }
+
+      uint64_t total = 0;
+
+      for (auto count : corruptions)
+      {
+        total += count;
+      }
+
+      return total;
+    }
+  }
+
+  /*
+    Corrupts a buffer with the given options.
+
+    @param data - The buffer to corrupt in place
+    @param size - Size of the buffer. Nothing at or past this is read or written.
+    @param options - Operation, value and range of the corruption
+    @param validator - Protection policy that decides if a byte may be placed at a location
+    @param seed - Seed for CorruptionType::Random
+
+    @return the amount of bytes that were corrupted.
+  */
+  template<typename V>
+  inline uint64_t corrupt(uint8_t* data, uint64_t size, const Options& options, const Validator<V>& validator, uint64_t seed)
+  {
+    //  A step of 0 would never leave the first byte
+    if (options.step == 0 || data == nullptr)
+    {
+      return 0;
+    }
+
+    switch (options.type)
+    {
+    case CorruptionType::Shift:             return detail::run<CorruptionType::Shift>(data, size, options, validator, seed);
+    case CorruptionType::Swap:              return detail::run<CorruptionType::Swap>(data, size, options, validator, seed);
+    case CorruptionType::Add:               return detail::run<CorruptionType::Add>(data, size, options, validator, seed);
+    case CorruptionType::Set:               return detail::run<CorruptionType::Set>(data, size, options, validator, seed);
+    case CorruptionType::Random:            return detail::run<CorruptionType::Random>(data, size, options, validator, seed);
+    case CorruptionType::RotateLeft:        return detail::run<CorruptionType::RotateLeft>(data, size, options, validator, seed);
+    case CorruptionType::RotateRight:       return detail::run<CorruptionType::RotateRight>(data, size, options, validator, seed);
+    case CorruptionType::LogicalAnd:        return detail::run<CorruptionType::LogicalAnd>(data, size, options, validator, seed);
+    case CorruptionType::LogicalOr:         return detail::run<CorruptionType::LogicalOr>(data, size, options, validator, seed);
+    case CorruptionType::LogicalXor:        return detail::run<CorruptionType::LogicalXor>(data, size, options, validator, seed);
+    case CorruptionType::LogicalComplement: return detail::run<CorruptionType::LogicalComplement>(data, size, options, validator, seed);
+    default:                                return 0; //  No corruption selected
+    }
+  }
+
+  template<typename V>
+  inline uint64_t corrupt(std::vector<uint8_t>& data, const Options& options, const Validator<V>& validator, uint64_t seed)
+  {
+    return corrupt(data.empty() ? nullptr : &data[0], data.size(), options, validator, seed);
+  }
+
+  /*
+    A range of offsets, empty when end is not past begin.
+  */
+  struct Range
+  {
+    Range() : begin(0), end(0) {};
+    Range(uint64_t begin, uint64_t end) : begin(begin), end(end) {};
+
+    uint64_t begin;
+    uint64_t end;
+  };
+
+  /*
+    Finds the part of a buffer that a corruption can write to, so output
+    only has to write that part over a copy of the original.
+
+    @param size - Size of the buffer
+    @param options - Options the buffer was corrupted with
+
+    @return the range of offsets that may have changed.
+  */
+  inline Range dirty(uint64_t size, const Options& options)
+  {
+    uint64_t end = std::min<uint64_t>(size, options.end);
+
+    if (options.step == 0 || options.type == CorruptionType::None || options.start >= end)
+    {
+      return Range();
+    }
+
+    //  Swap also writes the partner of the last offset
+    if (options.type == CorruptionType::Swap)
+    {
+      end = std::min<uint64_t>(size, end + options.value);
+    }
+
+    return Range(options.start, end);
+  }
+}
+
+#endif
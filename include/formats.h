@@ -0,0 +1,199 @@
+#ifndef _FORMATS_H
+#define _FORMATS_H
+
+/*
+  Registry of the formats that can be corrupted.
+
+  Every backend registers its format from its own source file with a
+  static Registrar, giving the flag that forces it, the extensions it is
+  known by and the magic values found at fixed offsets of its files. A
+  file is then matched in this order:
+
+    1. A flag in the arguments (--psp), which is removed from them
+    2. A magic value read from the start of the file
+    3. The extension of the file
+
+  Magic values are kept in a single table keyed by offset and value, so
+  probing a file is one lookup for each distinct offset no matter how
+  many formats are registered. Files that match nothing are corrupted as
+  plain data.
+*/
+
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "corrupt.h"
+#include "rom_cache.h"
+
+namespace formats
+{
+  /*
+    @param name - Four characters of a magic value
+
+    @return the characters as they read when stored big endian.
+  */
+  constexpr uint32_t fourcc(const char (&name)[5])
+  {
+    return (static_cast<uint32_t>(static_cast<uint8_t>(name[0])) << 24) |
+           (static_cast<uint32_t>(static_cast<uint8_t>(name[1])) << 16) |
+           (static_cast<uint32_t>(static_cast<uint8_t>(name[2])) << 8) |
+            static_cast<uint32_t>(static_cast<uint8_t>(name[3]));
+  }
+
+  //  A big endian 32 bit value found at a fixed offset of every file of a format
+  struct Signature
+  {
+    uint32_t offset;
+    uint32_t magic;
+  };
+
+  typedef std::function<void(const std::string&, std::vector<std::string>&)> Handler;
+
+  struct Format
+  {
+    std::string name;
+    std::string flag;                     //  Forces the format, empty for none
+    std::vector<std::string> extensions;  //  Lowercase with the dot
+    std::vector<Signature> signatures;
+    Handler handler;
+  };
+
+  class Registry
+  {
+  public:
+    /*
+      @return the registry shared by the whole process.
+    */
+    static Registry& shared();
+
+    /*
+      Adds a format. Flags, extensions and signatures that are already
+      taken keep their first format.
+
+      @param format - The format to add
+    */
+    void add(Format format);
+
+    /*
+      Finds the format of a file. A flag that forces a format is removed
+      from the arguments.
+
+      @param filename - The file to look at
+      @param args - Arguments of the run
+
+      @return the format, or nullptr when nothing matched.
+    */
+    const Format* detect(const std::string& filename, std::vector<std::string>& args);
+
+    /*
+      @param extension - Extension with the dot, in any case
+
+      @return whether a format is known by the extension.
+    */
+    bool known_extension(std::string extension);
+
+  private:
+    Registry() : m_probe_size(0) {};
+
+    std::deque<Format> m_formats;                                    //  Never moves what it holds
+    std::unordered_map<uint64_t, const Format*> m_signatures;        //  offset << 32 | magic
+    std::vector<uint32_t> m_offsets;                                 //  Distinct signature offsets, ascending
+    std::unordered_map<std::string, const Format*> m_extensions;
+    std::map<std::string, const Format*> m_flags;
+    uint32_t m_probe_size;                                           //  Bytes needed to check every offset
+    std::mutex m_mutex;
+  };
+
+  //  Registers a format when its source file is loaded
+  struct Registrar
+  {
+    Registrar(Format format)
+    {
+      Registry::shared().add(std::move(format));
+    }
+  };
+
+  /*
+    Expands the arguments of a run into the arguments of every variant it
+    makes. Values that are comma separated lists (--step 10,20) make a
+    variant for every combination of their values, and --variants N makes N
+    variants of each of those with their own seeds.
+
+    @param args - Arguments of the run, with --seed already set
+
+    @return the arguments of each variant, just args when there is one.
+  */
+  std::vector<std::vector<std::string>> variants(std::vector<std::string> args);
+
+  /*
+    Takes a class type derived from Corruption and forms a template to execute the corruption
+
+    @type T - a type derived from Corruption
+    @param filename - filename or fully qualified path of the file to corrupt
+    @param args - Custom arguments that will be passed to the given class T
+  */
+  template<typename T> void corrupt(std::string filename, std::vector<std::string> args);
+
+  /*
+    @type T - a type derived from Corruption
+
+    @return a handler that corrupts files as T.
+  */
+  template<typename T> Handler handler()
+  {
+    return [](const std::string& filename, std::vector<std::string>& args) { corrupt<T>(filename, args); };
+  }
+}
+
+template<typename T> void formats::corrupt(std::string filename, std::vector<std::string> args)
+{
+  //  Give off appropriate errors if this template is compiled with a bad type.
+  static_assert(std::is_base_of<Corruption, T>::value, "function only takes a derived class of Corruption.");
+
+  auto variant_args = variants(args);
+
+  //  In a batch the rom can be shared with other lines, so it is only corrupted through variants
+  bool cached = RomCache::shared().enabled();
+  std::shared_ptr<T> rom = RomCache::shared().load<T>(filename, variant_args[0]);
+
+  try
+  {
+    if (variant_args.size() == 1 && !cached)
+    {
+      rom->corrupt();
+
+      rom->save(rom->default_name());
+    }
+    else
+    {
+      //  The rom is loaded and analyzed once, every variant corrupts its own copy of it
+      ThreadPool::shared().parallel_for(variant_args.size(), [&rom, &variant_args](uint64_t i)
+      {
+        try
+        {
+          auto variant = rom->variant(variant_args[i]);
+
+          variant->corrupt();
+          variant->save(variant_args.size() == 1 ? variant->default_name() : variant->default_name() + "_" + std::to_string(i));
+        }
+        catch (const std::exception& e)
+        {
+          std::cerr << "Exception in variant " << i << ": " << e.what() << std::endl;
+        }
+      });
+    }
+  }
+  catch (const std::exception& e)
+  {
+    std::cerr << "Exception: " << e.what() << std::endl;
+  }
+}
+
+#endif
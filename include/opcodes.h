@@ -0,0 +1,168 @@
+#ifndef _OPCODES_H
+#define _OPCODES_H
+
+/*
+  Compile time opcode tables for the CPU backends.
+
+  An opcode Table holds the class and the length of every possible opcode
+  byte so that a validator can check an opcode with a single load instead of
+  searching a list. Tables are built from a list of Opcode entries by
+  make_table.
+
+  CPUs that encode the instruction class in wider fields (ARM, MIPS, 68000)
+  use a BitTable instead, which holds one bit for every value of the field
+  and is generated from a constexpr predicate by make_bit_table.
+*/
+
+#include <cstddef>
+#include <cstdint>
+
+namespace opcodes
+{
+  enum Class : uint8_t
+  {
+    None      = 0x00,
+    Branch    = 0x01, //  Jumps, calls and branches
+    Stack     = 0x02, //  Pushes and pulls
+    Return    = 0x04, //  Returns from subroutines and interrupts
+    LoadStore = 0x08, //  Reads or writes memory
+    Forbidden = 0x10, //  Never safe to write, halts or interrupts the CPU
+    Mode      = 0x20  //  Changes how the following instructions are decoded
+  };
+
+  struct Opcode
+  {
+    uint8_t opcode;
+    uint8_t flags;
+    uint8_t length; //  Length of the instruction including the opcode byte
+  };
+
+  struct Table
+  {
+    uint8_t flags[0x100];
+    uint8_t length[0x100];
+
+    constexpr bool is(uint8_t opcode, uint8_t classes) const
+    {
+      return (flags[opcode] & classes) != 0;
+    }
+
+    /*
+      Checks if an instruction of the given classes covers a location,
+      either as the opcode itself or as one of its operands.
+
+      @param data - Start of the code
+      @param location - Offset into data to check
+      @param classes - Classes of instructions to look for
+
+      @return true if an instruction of @classes starts less than its
+              length before @location.
+    */
+    inline bool covers(const uint8_t* data, uint32_t location, uint8_t classes) const
+    {
+      for (uint32_t i = 0; i < Max_Length && i <= location; i++)
+      {
+        uint8_t opcode = data[location - i];
+
+        if ((flags[opcode] & classes) && length[opcode] > i)
+        {
+          return true;
+        }
+      }
+
+      return false;
+    }
+
+    static const uint32_t Max_Length = 4;
+  };
+
+  template<size_t N> constexpr Table make_table(const Opcode (&list)[N])
+  {
+    Table table{};
+
+    for (size_t i = 0; i < N; i++)
+    {
+      table.flags[list[i].opcode] |= list[i].flags;
+
+      if (list[i].length > table.length[list[i].opcode])
+      {
+        table.length[list[i].opcode] = list[i].length;
+      }
+    }
+
+    return table;
+  }
+
+  template<size_t Bits> struct BitTable
+  {
+    uint64_t bits[(Bits + 63) / 64];
+
+    constexpr bool test(uint32_t index) const
+    {
+      return (bits[index >> 6] >> (index & 63)) & 1;
+    }
+  };
+
+  template<size_t Bits> constexpr BitTable<Bits> make_bit_table(bool (*predicate)(uint32_t))
+  {
+    BitTable<Bits> table{};
+
+    for (uint32_t i = 0; i < Bits; i++)
+    {
+      if (predicate(i))
+      {
+        table.bits[i >> 6] |= 1ull << (i & 63);
+      }
+    }
+
+    return table;
+  }
+
+  namespace arm
+  {
+    /*
+      ARM instructions are classified by opcode 1 (bits 20 to 27) and
+      opcode 2 (bits 4 to 7):
+
+      +-----------------------------------------------------+
+      |31  28|27      20|19               8|7        4|3   0|
+      |-----------------------------------------------------|
+      | COND | OPCODE 1 | PARAMETERS/OTHER | OPCODE 2 | RM  |
+      +-----------------------------------------------------+
+
+      @param index - (opcode1 << 4) | opcode2
+
+      @return true if the instruction is a jump or a load/store.
+    */
+    constexpr bool is_protected(uint32_t index)
+    {
+      uint32_t opcode1 = index >> 4;
+      uint32_t opcode2 = index & 0x0F;
+
+      //  When opcode1 is between 0x80 and 0xE0 it will be jumps or load/store
+      //  Opcode1 between 0x40 and 0x60 are all load/store
+      //  Every even opcode2 with opcode1 between 0x60 and 0x80 is a load/store
+      return (opcode1 >= 0x80 && opcode1 < 0xE0) ||
+             (opcode1 >= 0x40 && opcode1 < 0x60) ||
+             (opcode1 >= 0x60 && opcode1 < 0x80 && opcode2 % 2 == 0) ||
+             //  All opcode2 that end with 0x0B are load/store
+             (opcode1 < 0x20 && (opcode2 & 0x0B) == 0x0B) ||
+             //  All opcode2 that end with 0x0D or 0x0F and have an odd opcode1 are load/store
+             (opcode1 < 0x20 && opcode1 % 2 == 1 && ((opcode2 & 0x0D) == 0x0D || (opcode2 & 0x0F) == 0x0F));
+    }
+
+    constexpr BitTable<0x1000> protected_table = make_bit_table<0x1000>(is_protected);
+
+    /*
+      @param instruction - A 32 bit ARM instruction
+
+      @return true if the instruction is a jump or a load/store.
+    */
+    inline bool is_protected_instruction(uint32_t instruction)
+    {
+      return protected_table.test(((instruction >> 16) & 0xFF0) | ((instruction >> 4) & 0x0F));
+    }
+  }
+}
+
+#endif
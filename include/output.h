@@ -0,0 +1,60 @@
+#ifndef _OUTPUT_H
+#define _OUTPUT_H
+
+/*
+  Writing corrupted disc images.
+
+  A corruption changes a small part of an image that can be gigabytes in
+  size, so instead of writing the whole image the output is made as a
+  clone of the source file and only the changed ranges are written over
+  it. Cloning shares the blocks of the source where the filesystem allows
+  it (FICLONE on Btrfs, XFS and similar), and otherwise copies inside of
+  the kernel with copy_file_range. Other systems fall back to a regular
+  copy.
+*/
+
+#include <cstdint>
+#include <fstream>
+#include <string>
+
+namespace output
+{
+  /*
+    Makes target a copy of source, replacing it if it exists.
+
+    @param source - The file to copy
+    @param target - The file to make
+  */
+  void clone(const std::string& source, const std::string& target);
+
+  /*
+    An existing file opened to be written in place at any offset.
+  */
+  class File
+  {
+  public:
+    /*
+      @param filename - The file to open, throws FileOpenException when it
+                        can not be opened for writing.
+    */
+    explicit File(const std::string& filename);
+    ~File();
+
+    File(const File&) = delete;
+    File& operator=(const File&) = delete;
+
+    /*
+      @param offset - Where to write in the file
+      @param data - The bytes to write
+      @param size - Amount of bytes
+    */
+    void write(uint64_t offset, const uint8_t* data, size_t size);
+
+  private:
+    std::string m_filename;
+    int m_fd;               //  Used where pwrite exists
+    std::fstream m_file;    //  Used everywhere else
+  };
+}
+
+#endif
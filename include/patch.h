@@ -0,0 +1,162 @@
+#ifndef _PATCH_H
+#define _PATCH_H
+
+/*
+  Patch output.
+
+  Instead of writing out the whole corrupted rom (or disc image) the edits
+  can be saved as a patch against the original file:
+
+    IPS - Offsets up to 16 MB, no checksums
+    BPS - Any size, CRC32 of the source, target and patch
+    UPS - Any size, CRC32 of the source, target and patch
+
+  Edits are collected by a Recorder in the coordinates of the original file,
+  in any order. Consecutive edits are kept together as runs of bytes, so a
+  corruption of a whole disc costs about one byte of memory per changed
+  byte. Bytes that end up the same as the original are left out when the
+  patch is written.
+*/
+
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace patch
+{
+  enum Format
+  {
+    None,
+    IPS,
+    BPS,
+    UPS
+  };
+
+  /*
+    @param name - ips, bps or ups in any case
+
+    @return the format with the given name, throws InvalidArgumentException
+            if there is none.
+  */
+  Format format(const std::string& name);
+
+  /*
+    @return the file extension for the format, including the dot.
+  */
+  std::string extension(Format format);
+
+  /*
+    @param data - Bytes to hash
+    @param size - Amount of bytes
+    @param crc - Result of the previous call when hashing in parts
+
+    @return the CRC32 (as used by zip, BPS and UPS) of the data.
+  */
+  uint32_t crc32(const uint8_t* data, size_t size, uint32_t crc = 0);
+
+  /*
+    Consecutive bytes of the target file.
+  */
+  struct Run
+  {
+    uint64_t offset;
+    std::vector<uint8_t> bytes;
+  };
+
+  class Recorder
+  {
+  public:
+    Recorder() : m_sorted(true) {};
+
+    inline void record(uint64_t offset, uint8_t byte)
+    {
+      if (!m_runs.empty())
+      {
+        Run& last = m_runs.back();
+        uint64_t end = last.offset + last.bytes.size();
+
+        if (offset == end)
+        {
+          last.bytes.push_back(byte);
+          return;
+        }
+
+        m_sorted = m_sorted && offset > end;
+      }
+
+      m_runs.push_back(Run{ offset, { byte } });
+    }
+
+    /*
+      Records every byte that differs between two buffers of the same size.
+
+      @param offset - Offset of the buffers in the original file
+      @param original - Bytes before the corruption
+      @param modified - Bytes after the corruption
+    */
+    void diff(uint64_t offset, const std::vector<uint8_t>& original, const std::vector<uint8_t>& modified);
+    void diff(uint64_t offset, const uint8_t* original, const uint8_t* modified, size_t size);
+
+    /*
+      Moves the edits of another recorder after the ones of this one, so
+      they win over edits of this one at the same offset.
+
+      @param other - The edits to add, empty afterwards
+    */
+    void append(Recorder&& other);
+
+    inline bool empty() const
+    {
+      return m_runs.empty();
+    }
+
+    inline void clear()
+    {
+      m_runs.clear();
+      m_sorted = true;
+    }
+
+    /*
+      @return the edits merged into runs sorted by offset. When an offset was
+              recorded more than once the last byte wins. The runs are only
+              valid until the next edit is recorded.
+    */
+    const std::vector<Run>& runs() const;
+
+  private:
+    //  Merges the runs in place when they were not recorded in order
+    void merge() const;
+
+    //  Runs in the order they were recorded, or sorted once merged
+    mutable std::vector<Run> m_runs;
+    //  Whether the runs are sorted by offset, apart and not overlapping
+    mutable bool m_sorted;
+  };
+
+  /*
+    Writes the recorded edits as a patch.
+
+    @param filename - File to write the patch to
+    @param format - Format of the patch
+    @param edits - Edits in the coordinates of the source
+    @param source - The unmodified data the patch applies to
+  */
+  void write(const std::string& filename, Format format, const Recorder& edits, const std::vector<uint8_t>& source);
+
+  /*
+    Same as above, reading the unmodified data from a file. The file is only
+    read, so a patch of a disc image never needs a copy of the image.
+  */
+  void write(const std::string& filename, Format format, const Recorder& edits, const std::string& source);
+
+  /*
+    Writes the recorded edits over an existing file.
+
+    @param filename - File to change in place
+    @param edits - Edits in the coordinates of the file
+  */
+  void apply(const std::string& filename, const Recorder& edits);
+}
+
+#endif
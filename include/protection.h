@@ -0,0 +1,201 @@
+#ifndef _CORRUPTION_PROTECTION_H
+#define _CORRUPTION_PROTECTION_H
+
+/*
+  Precomputed protections for a rom.
+
+  The validators used to scan opcode tables on every call, which made them
+  the most expensive part of a corruption. A ProtectionMap runs the location
+  checks of a validator once over the original contents of the rom and keeps
+  the result as one bit per offset, along with a 256 entry table of byte
+  values the validator allows before its values_end. After that a check is
+  a single bit test.
+
+  The location checks are independent of each other so the analysis is split
+  by region across the shared thread pool. Regions are aligned to 64 offsets
+  so every thread owns whole words of the bitmap.
+*/
+
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <mutex>
+#include <vector>
+
+#include "engine.h"
+#include "thread_pool.h"
+
+namespace engine
+{
+  class ProtectionMap : public Validator<ProtectionMap>
+  {
+  public:
+    static const bool Precomputed = true;
+
+    ProtectionMap() : m_begin(0), m_end(0), m_values_end(0), m_analyzed(false), m_values{ 0, 0, 0, 0 } {};
+
+    /*
+      Runs a validator over [begin, end) of the data and stores the result.
+      Offsets outside of the range are treated as protected.
+
+      @param size - Size of the data the validator reads from
+      @param validator - Validator whose protected_location, valid_value and values_end are used
+      @param begin - First offset to analyze
+      @param end - Offsets at or past this are not analyzed
+    */
+    template<typename V> void analyze(uint32_t size, const Validator<V>& validator,
+                                      uint32_t begin = 0, uint32_t end = std::numeric_limits<uint32_t>::max());
+
+    /*
+      Same as analyze, but only the first call does the analysis. Threads
+      sharing the map wait for it instead of analyzing again.
+    */
+    template<typename V> void analyze_once(uint32_t size, const Validator<V>& validator,
+                                           uint32_t begin = 0, uint32_t end = std::numeric_limits<uint32_t>::max())
+    {
+      std::call_once(m_once, [&] { this->analyze(size, validator, begin, end); });
+    }
+
+    inline bool analyzed() const
+    {
+      return m_analyzed;
+    }
+
+    inline bool protected_location(uint32_t location) const
+    {
+      if (location < m_begin || location >= m_end)
+      {
+        return true;
+      }
+
+      uint32_t index = location - m_begin;
+
+      return (m_bits[index >> 6] >> (index & 63)) & 1;
+    }
+
+    inline bool valid_value(uint8_t byte) const
+    {
+      return (m_values[byte >> 6] >> (byte & 63)) & 1;
+    }
+
+    inline uint32_t values_end() const
+    {
+      return m_values_end;
+    }
+
+    inline bool valid_byte(uint8_t byte, uint32_t location) const
+    {
+      return (location >= m_values_end || valid_value(byte)) && !protected_location(location);
+    }
+
+    inline bool allowed_values(uint32_t location, Values& values) const
+    {
+      if (protected_location(location))
+      {
+        std::fill(values.words, values.words + 4, 0);
+      }
+      else if (location >= m_values_end)
+      {
+        std::fill(values.words, values.words + 4, ~0ull);
+      }
+      else
+      {
+        std::copy(m_values, m_values + 4, values.words);
+      }
+
+      return true;
+    }
+
+    inline simd::Protection protection() const
+    {
+      simd::Protection protection;
+
+      protection.bits = &m_bits[0];
+      protection.begin = m_begin;
+      protection.end = m_end;
+
+      //  Skip the value lookups when every value is allowed
+      if ((m_values[0] & m_values[1] & m_values[2] & m_values[3]) != ~0ull)
+      {
+        protection.values = m_values;
+
+        //  The kernels check the values at every offset, so offsets past the
+        //  end of the values are left alone instead of taking any value
+        protection.end = std::min(m_end, std::max(m_begin, m_values_end));
+      }
+
+      return protection;
+    }
+
+  private:
+    //  Smallest region handed to a single thread
+    static const uint32_t Region_Size = 0x10000;
+
+    uint32_t m_begin;
+    uint32_t m_end;
+    uint32_t m_values_end;  //  Offsets at or past this allow every value
+    bool m_analyzed;
+    std::once_flag m_once;
+
+    uint64_t m_values[4];         //  Bit set for each allowed byte value
+    std::vector<uint64_t> m_bits; //  Bit set for each protected offset
+  };
+
+  template<typename V> void ProtectionMap::analyze(uint32_t size, const Validator<V>& validator, uint32_t begin, uint32_t end)
+  {
+    m_begin = std::min(begin, size);
+    m_end = std::max(m_begin, std::min(end, size));
+    m_values_end = validator.values_limit();
+
+    std::fill(m_values, m_values + 4, 0);
+
+    for (uint32_t i = 0; i < 0x100; i++)
+    {
+      if (validator.allows(static_cast<uint8_t>(i)))
+      {
+        m_values[i >> 6] |= 1ull << (i & 63);
+      }
+    }
+
+    uint32_t length = m_end - m_begin;
+    //  Always keep one word so the bits can be handed to the vector kernels
+    m_bits.assign(std::max<uint64_t>(1, (static_cast<uint64_t>(length) + 63) / 64), 0);
+
+    //  Marks protected offsets in the words [first, last) of the bitmap
+    auto scan = [this, &validator, length](uint32_t first, uint32_t last)
+    {
+      for (uint32_t word = first; word < last; word++)
+      {
+        uint64_t bits = 0;
+        uint32_t base = word * 64;
+        uint32_t count = std::min<uint32_t>(64, length - base);
+
+        for (uint32_t bit = 0; bit < count; bit++)
+        {
+          if (validator.protects(m_begin + base + bit))
+          {
+            bits |= 1ull << bit;
+          }
+        }
+
+        m_bits[word] = bits;
+      }
+    };
+
+    uint32_t words = m_bits.size();
+    uint32_t per_region = Region_Size / 64;
+    uint32_t regions = (words + per_region - 1) / per_region;
+
+    //  Analysis runs inside of batch lines and variants that are already on
+    //  the pool, which lets the calling worker take part instead of waiting
+    ThreadPool::shared().parallel_for(regions, [&scan, words, per_region](uint64_t region)
+    {
+      uint32_t first = region * per_region;
+      scan(first, std::min(words, first + per_region));
+    });
+
+    m_analyzed = true;
+  }
+}
+
+#endif
@@ -0,0 +1,117 @@
+#ifndef _RNG_H
+#define _RNG_H
+
+/*
+  Counter based random number generation.
+
+  A Counter generator has no state besides its key and a position, so the
+  numbers for any (seed, stream) pair can be produced independently of
+  every other stream. The engine uses the chunk index as the stream which
+  keeps the output the same no matter which thread runs which chunk.
+
+  The output is the splitmix64 finalizer applied to the key plus the
+  position, which passes BigCrush and is far cheaper than a mt19937 seed.
+
+  Seeds that aren't given with --seed are derived from entropy that is
+  drawn once per process, and passed down to sub files as streams so a
+  whole run can be repeated from the one seed that gets printed.
+*/
+
+#include <atomic>
+#include <cstdint>
+#include <limits>
+#include <random>
+#include <string>
+
+namespace rng
+{
+  inline uint64_t mix(uint64_t x)
+  {
+    x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ull;
+    x = (x ^ (x >> 27)) * 0x94D049BB133111EBull;
+    return x ^ (x >> 31);
+  }
+
+  class Counter
+  {
+  public:
+    typedef uint64_t result_type;
+
+    Counter(uint64_t seed = 0, uint64_t stream = 0) : m_key(mix(seed ^ mix(stream + Golden))), m_counter(0) {};
+
+    static constexpr result_type min() { return 0; }
+    static constexpr result_type max() { return std::numeric_limits<result_type>::max(); }
+
+    inline result_type operator()()
+    {
+      return mix(m_key + ++m_counter * Golden);
+    }
+
+    /*
+      @return a uniformly distributed byte.
+    */
+    inline uint8_t byte()
+    {
+      return static_cast<uint8_t>((*this)() >> 56);
+    }
+
+  private:
+    static const uint64_t Golden = 0x9E3779B97F4A7C15ull;
+
+    uint64_t m_key;
+    uint64_t m_counter;
+  };
+
+  /*
+    Derives an independent seed for a part of a run.
+
+    @param seed - Seed of the run
+    @param stream - Identifies the part (file index, section, path hash)
+  */
+  inline uint64_t derive(uint64_t seed, uint64_t stream)
+  {
+    return Counter(seed, stream)();
+  }
+
+  /*
+    FNV-1a hash for using names as streams. Unlike std::hash it is the same
+    on every platform, which keeps seeds portable.
+  */
+  inline uint64_t hash(const std::string& str)
+  {
+    uint64_t hash = 0xCBF29CE484222325ull;
+
+    for (char c : str)
+    {
+      hash = (hash ^ static_cast<uint8_t>(c)) * 0x100000001B3ull;
+    }
+
+    return hash;
+  }
+
+  /*
+    @return 64 bits from the random device, only drawn on the first call.
+  */
+  inline uint64_t entropy()
+  {
+    static const uint64_t value = []
+    {
+      std::random_device rd;
+      return (static_cast<uint64_t>(rd()) << 32) ^ rd();
+    }();
+
+    return value;
+  }
+
+  /*
+    @return a new seed, different for every call in the process.
+  */
+  inline uint64_t next_seed()
+  {
+    static std::atomic<uint64_t> counter(0);
+
+    return derive(entropy(), counter++);
+  }
+}
+
+#endif
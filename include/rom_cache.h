@@ -0,0 +1,130 @@
+#ifndef _ROM_CACHE_H
+#define _ROM_CACHE_H
+
+/*
+  Loaded roms shared by the lines of a batch.
+
+  A rom is loaded the first time a line asks for it and kept until the
+  cache is cleared. The key is the path, size and modification time of
+  the file, so a file that changes during a batch is loaded again. The
+  cached corruption is never corrupted itself, lines make a variant of it
+  which copies the rom and shares everything that was parsed or analyzed.
+*/
+
+#include <boost/filesystem.hpp>
+
+#include <future>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <typeinfo>
+#include <vector>
+
+#include "corrupt.h"
+
+class RomCache
+{
+public:
+  /*
+    @return the cache shared by the whole process.
+  */
+  static RomCache& shared()
+  {
+    static RomCache cache;
+    return cache;
+  }
+
+  /*
+    Only batches turn the cache on, a single run has no use for keeping
+    an untouched copy of the rom around.
+  */
+  inline void enable(bool enabled)
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_enabled = enabled;
+  }
+
+  inline bool enabled()
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_enabled;
+  }
+
+  /*
+    Loads a rom, or waits for and returns the copy already loaded by
+    another line. When the cache is off this just loads the rom.
+
+    @param filename - The rom to load
+    @param args - Arguments of the line, used if the rom has to be loaded
+
+    @return the loaded rom, which must not be corrupted when cached.
+  */
+  template<typename T> std::shared_ptr<T> load(const std::string& filename, std::vector<std::string>& args);
+
+  /*
+    Drops every rom, lines still using one keep it alive until they finish.
+  */
+  inline void clear()
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_roms.clear();
+  }
+
+private:
+  RomCache() : m_enabled(false) {};
+
+  std::map<std::string, std::shared_future<std::shared_ptr<Corruption>>> m_roms;
+  std::mutex m_mutex;
+  bool m_enabled;
+};
+
+template<typename T> std::shared_ptr<T> RomCache::load(const std::string& filename, std::vector<std::string>& args)
+{
+  if (!this->enabled())
+  {
+    return std::make_shared<T>(filename, args);
+  }
+
+  std::string key = boost::filesystem::absolute(filename).string() + "|" +
+                    std::to_string(boost::filesystem::file_size(filename)) + "|" +
+                    std::to_string(boost::filesystem::last_write_time(filename)) + "|" +
+                    typeid(T).name();
+
+  std::promise<std::shared_ptr<Corruption>> loaded;
+  std::shared_future<std::shared_ptr<Corruption>> rom;
+  bool loader = false;
+
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto found = m_roms.find(key);
+
+    if (found == m_roms.end())
+    {
+      rom = loaded.get_future().share();
+      m_roms[key] = rom;
+      loader = true;
+    }
+    else
+    {
+      rom = found->second;
+    }
+  }
+
+  //  Load outside of the lock so other roms can load at the same time
+  if (loader)
+  {
+    try
+    {
+      loaded.set_value(std::make_shared<T>(filename, args));
+    }
+    catch (...)
+    {
+      loaded.set_exception(std::current_exception());
+    }
+  }
+
+  return std::static_pointer_cast<T>(rom.get());
+}
+
+#endif
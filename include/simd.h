@@ -0,0 +1,87 @@
+#ifndef _SIMD_H
+#define _SIMD_H
+
+/*
+  Vector kernels for the corruption engine.
+
+  Add, Set, the rotates and the logical operations only depend on the byte
+  that is being replaced, so with a small step they can be run on 16 or 32
+  bytes at a time. Steps of 1, 2 and 4 divide the vector width, which means
+  the positions that get corrupted inside of every block are the same and
+  can be applied with a constant blend mask.
+
+  The kernels are picked at runtime from the CPU (AVX2, then SSE2). When
+  neither is available, or the operation/step is not supported, transform
+  returns false and the engine runs its scalar loop instead.
+*/
+
+#include <cstdint>
+
+#include "corruptioninfo.h"
+
+namespace simd
+{
+  /*
+    Protections the kernels can check by themselves. A default constructed
+    Protection protects nothing.
+  */
+  struct Protection
+  {
+    Protection() : bits(nullptr), begin(0), end(0), values(nullptr) {};
+
+    const uint64_t* bits;   //  One bit per protected offset in [begin, end), nullptr if no offset is protected
+    uint32_t begin;         //  Offsets outside of [begin, end) are protected when bits is set
+    uint32_t end;
+    const uint64_t* values; //  256 bits of allowed byte values, nullptr if every value is allowed
+  };
+
+  enum Level
+  {
+    Scalar,
+    SSE2,
+    AVX2
+  };
+
+  /*
+    @return the best instruction set supported by this CPU.
+  */
+  Level level();
+
+  /*
+    Runs an operation over [start, end) of a buffer.
+
+    @param type - The operation to apply
+    @param value - Operand of the operation
+    @param data - Buffer to corrupt
+    @param start - First offset to corrupt
+    @param end - Offsets at or past this are not touched
+    @param step - Distance between corrupted offsets
+    @param protection - Protected offsets and values
+    @param corruptions - Set to the amount of bytes that were corrupted
+
+    @return false if there is no kernel for the operation, step or CPU, the
+            buffer is left untouched in that case.
+  */
+  bool transform(CorruptionType type, uint32_t value, uint8_t* data, uint64_t start, uint64_t end,
+                 uint32_t step, const Protection& protection, uint64_t& corruptions);
+
+  /*
+    Accumulates rows of bytes into the two sums of a Reed-Solomon parity
+    over GF(2^8) (x^8 + x^4 + x^3 + x^2 + 1), as used by the ECC of CD
+    sectors. For every row and every lane i:
+
+      a[i] = (a[i] ^ row[i]) * 2
+      b[i] = b[i] ^ row[i]
+
+    Lanes are independent, so they run 16 or 32 at a time.
+
+    @param rows - count rows of width bytes each, one after the other
+    @param count - Amount of rows
+    @param width - Bytes in a row, and size of a and b
+    @param a - Sum that is multiplied after every row
+    @param b - Plain sum
+  */
+  void parity(const uint8_t* rows, uint32_t count, uint32_t width, uint8_t* a, uint8_t* b);
+}
+
+#endif
@@ -0,0 +1,346 @@
+#ifndef _THREAD_POOL_H
+#define _THREAD_POOL_H
+
+/*
+  A fixed size pool of worker threads shared by the whole process.
+
+  Every worker has its own queue. Tasks submitted from a worker go to the
+  back of its queue and it takes them from the back again, so nested work
+  stays on the thread that made it. A worker that runs out of tasks takes
+  from the shared queue and then steals from the front of the queues of
+  the other workers. Idle workers sleep until there is a task for them.
+
+  Tasks submitted from outside of the pool go to the shared queue, which
+  is bounded so submitting blocks until the workers catch up.
+
+  parallel_for lets the calling thread take part in the work and only
+  waits for work that has actually been started, so it is safe to call
+  from inside of a task that is running on the pool.
+*/
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+class ThreadPool
+{
+public:
+  ThreadPool(uint32_t threads = std::max(1u, std::thread::hardware_concurrency()), uint32_t capacity = 256);
+  ~ThreadPool();
+
+  ThreadPool(const ThreadPool&) = delete;
+  ThreadPool& operator=(const ThreadPool&) = delete;
+
+  /*
+    @return the pool shared by the whole process.
+  */
+  static ThreadPool& shared();
+
+  inline uint32_t size() const
+  {
+    return m_workers.size();
+  }
+
+  /*
+    Queues a task on the pool. Outside of the pool this waits while the
+    shared queue is full.
+
+    @param task - The function to run
+
+    @return a future for the result of the task.
+  */
+  template<typename F> auto submit(F task) -> std::future<decltype(task())>;
+
+  /*
+    Runs body(i) for every i in [0, count) on the pool and the calling
+    thread. The first exception thrown by body is rethrown here.
+
+    @param count - Amount of indices
+    @param body - Function taking the index
+  */
+  template<typename F> void parallel_for(uint64_t count, F body);
+
+private:
+  struct Queue
+  {
+    std::deque<std::function<void()>> tasks;
+    std::mutex mutex;
+  };
+
+  //  The pool and queue of the worker running on this thread, if any
+  struct Worker
+  {
+    ThreadPool* pool;
+    uint32_t index;
+  };
+
+  static Worker& current();
+
+  void push(std::function<void()> task, bool bounded);
+  std::function<void()> take();
+  void run(uint32_t index);
+
+  std::vector<std::thread> m_workers;
+  std::vector<std::unique_ptr<Queue>> m_queues;  //  One per worker, the last one is shared
+  uint32_t m_capacity;
+  uint64_t m_pending;                             //  Tasks queued and not yet claimed by a worker
+  std::mutex m_mutex;
+  std::condition_variable m_available;
+  std::condition_variable m_space;
+  bool m_stop;
+};
+
+inline ThreadPool::ThreadPool(uint32_t threads, uint32_t capacity) : m_capacity(capacity), m_pending(0), m_stop(false)
+{
+  for (uint32_t i = 0; i <= threads; i++)
+  {
+    m_queues.push_back(std::make_unique<Queue>());
+  }
+
+  for (uint32_t i = 0; i < threads; i++)
+  {
+    m_workers.emplace_back(&ThreadPool::run, this, i);
+  }
+}
+
+inline ThreadPool::~ThreadPool()
+{
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_stop = true;
+  }
+
+  m_available.notify_all();
+
+  for (auto& worker : m_workers)
+  {
+    worker.join();
+  }
+}
+
+inline ThreadPool& ThreadPool::shared()
+{
+  static ThreadPool pool;
+  return pool;
+}
+
+inline ThreadPool::Worker& ThreadPool::current()
+{
+  thread_local Worker worker = { nullptr, 0 };
+  return worker;
+}
+
+/*
+  Queues a task on the queue of the calling worker, or the shared queue
+  when called from outside of the pool.
+
+  @param task - The task to queue
+  @param bounded - Wait for space in the shared queue first
+*/
+inline void ThreadPool::push(std::function<void()> task, bool bounded)
+{
+  Worker& worker = current();
+  Queue* queue = m_queues.back().get();
+
+  if (worker.pool == this)
+  {
+    queue = m_queues[worker.index].get();
+  }
+  else if (bounded)
+  {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_space.wait(lock, [this, queue]
+    {
+      std::lock_guard<std::mutex> guard(queue->mutex);
+      return queue->tasks.size() < m_capacity;
+    });
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(queue->mutex);
+    queue->tasks.push_back(std::move(task));
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_pending++;
+  }
+
+  m_available.notify_one();
+}
+
+/*
+  Takes a task that the calling worker has already claimed, first from
+  the back of its own queue, then from the shared queue and then from the
+  front of the other queues.
+
+  @return the task.
+*/
+inline std::function<void()> ThreadPool::take()
+{
+  uint32_t own = current().index;
+  uint32_t count = m_queues.size();
+
+  for (;;)
+  {
+    {
+      Queue& queue = *m_queues[own];
+      std::lock_guard<std::mutex> lock(queue.mutex);
+
+      if (!queue.tasks.empty())
+      {
+        auto task = std::move(queue.tasks.back());
+        queue.tasks.pop_back();
+        return task;
+      }
+    }
+
+    for (uint32_t i = 1; i <= count; i++)
+    {
+      //  Start at the shared queue, which is the last one
+      Queue& queue = *m_queues[(count - 2 + i) % count];
+
+      if (&queue == m_queues[own].get())
+      {
+        continue;
+      }
+
+      std::unique_lock<std::mutex> lock(queue.mutex);
+
+      if (!queue.tasks.empty())
+      {
+        auto task = std::move(queue.tasks.front());
+        queue.tasks.pop_front();
+        lock.unlock();
+
+        if (&queue == m_queues.back().get())
+        {
+          //  Pass through the lock so a submitter that just saw a full queue is already waiting
+          {
+            std::lock_guard<std::mutex> guard(m_mutex);
+          }
+
+          m_space.notify_one();
+        }
+
+        return task;
+      }
+    }
+
+    //  The claimed task is being moved between queues, look again
+    std::this_thread::yield();
+  }
+}
+
+inline void ThreadPool::run(uint32_t index)
+{
+  current() = { this, index };
+
+  for (;;)
+  {
+    {
+      std::unique_lock<std::mutex> lock(m_mutex);
+      m_available.wait(lock, [this] { return m_stop || m_pending > 0; });
+
+      if (m_pending == 0)
+      {
+        return;
+      }
+
+      //  Every claim matches a queued task, so take always finds one
+      m_pending--;
+    }
+
+    take()();
+  }
+}
+
+template<typename F> auto ThreadPool::submit(F task) -> std::future<decltype(task())>
+{
+  typedef decltype(task()) R;
+
+  auto packaged = std::make_shared<std::packaged_task<R()>>(std::move(task));
+  std::future<R> result = packaged->get_future();
+
+  this->push([packaged] { (*packaged)(); }, true);
+
+  return result;
+}
+
+template<typename F> void ThreadPool::parallel_for(uint64_t count, F body)
+{
+  if (count == 0)
+  {
+    return;
+  }
+
+  //  Shared with the helpers, which can outlive this call if they start late
+  struct Job
+  {
+    Job(uint64_t count, F body) : count(count), body(std::move(body)), next(0), done(0) {};
+
+    uint64_t count;
+    F body;
+    std::atomic<uint64_t> next;
+    std::atomic<uint64_t> done;
+    std::mutex mutex;
+    std::condition_variable finished;
+    std::exception_ptr error;
+  };
+
+  auto job = std::make_shared<Job>(count, std::move(body));
+
+  auto work = [job]
+  {
+    for (uint64_t i = job->next++; i < job->count; i = job->next++)
+    {
+      try
+      {
+        job->body(i);
+      }
+      catch (...)
+      {
+        std::lock_guard<std::mutex> lock(job->mutex);
+
+        if (!job->error)
+        {
+          job->error = std::current_exception();
+        }
+      }
+
+      if (++job->done == job->count)
+      {
+        std::lock_guard<std::mutex> lock(job->mutex);
+        job->finished.notify_all();
+      }
+    }
+  };
+
+  uint64_t helpers = std::min<uint64_t>(count - 1, size());
+
+  for (uint64_t i = 0; i < helpers; i++)
+  {
+    this->push(work, false);
+  }
+
+  work();
+
+  std::unique_lock<std::mutex> lock(job->mutex);
+  job->finished.wait(lock, [&job] { return job->done == job->count; });
+
+  if (job->error)
+  {
+    std::rethrow_exception(job->error);
+  }
+}
+
+#endif
@@ -37,11 +37,18 @@ THE POSSIBILITY OF SUCH DAMAGE.
 #ifndef _UTIL_H
 #define _UTIL_H
 
+#include <boost/filesystem.hpp>
+#include <boost/interprocess/file_mapping.hpp>
+#include <boost/interprocess/mapped_region.hpp>
+
 #include <iostream>
 #include <algorithm>
 #include <sstream>
 #include <fstream>
 #include <cstdint>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
 #include <vector>
 
 namespace util
@@ -95,6 +102,257 @@ namespace util
     }
   }
 
+  /*
+    How a mapped file will be gone through, passed on to the OS so it can
+    read ahead or not.
+  */
+  enum class Access
+  {
+    Normal,
+    Sequential,
+    Random
+  };
+
+  /*
+    A file mapped into memory instead of read into a vector, so only the
+    pages that are touched are ever read.
+
+    Writable mappings are private and copy-on-write: writing changes the
+    pages of this mapping only and never the file, so a rom can be
+    corrupted in place and mapping the same file again gives another
+    untouched copy of it for free. A missing or empty file maps to nothing,
+    the same as read_file returning an empty vector.
+  */
+  class MappedFile
+  {
+  public:
+    MappedFile(const std::string& filename, bool writable = true, Access access = Access::Normal) : m_filename(filename)
+    {
+      boost::system::error_code error;
+
+      if (boost::filesystem::file_size(filename, error) == 0 || error)
+      {
+        return;
+      }
+
+      auto mode = writable ? boost::interprocess::copy_on_write : boost::interprocess::read_only;
+
+      m_file = boost::interprocess::file_mapping(filename.c_str(), boost::interprocess::read_only);
+      m_region = boost::interprocess::mapped_region(m_file, mode);
+
+      this->advise(access);
+    }
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    inline void advise(Access access)
+    {
+      if (m_region.get_size() == 0)
+      {
+        return;
+      }
+
+      switch (access)
+      {
+      case Access::Sequential:
+        m_region.advise(boost::interprocess::mapped_region::advice_sequential);
+        break;
+      case Access::Random:
+        m_region.advise(boost::interprocess::mapped_region::advice_random);
+        break;
+      default:
+        m_region.advise(boost::interprocess::mapped_region::advice_normal);
+        break;
+      }
+    }
+
+    inline uint8_t* data()
+    {
+      return static_cast<uint8_t*>(m_region.get_address());
+    }
+
+    inline const uint8_t* data() const
+    {
+      return static_cast<const uint8_t*>(m_region.get_address());
+    }
+
+    inline size_t size() const
+    {
+      return m_region.get_size();
+    }
+
+    inline bool empty() const
+    {
+      return size() == 0;
+    }
+
+    inline uint8_t& operator[](size_t index)
+    {
+      return data()[index];
+    }
+
+    inline uint8_t* begin()
+    {
+      return data();
+    }
+
+    inline uint8_t* end()
+    {
+      return data() + size();
+    }
+
+    inline const std::string& filename() const
+    {
+      return m_filename;
+    }
+
+  private:
+    std::string m_filename;
+    boost::interprocess::file_mapping m_file;
+    boost::interprocess::mapped_region m_region;
+  };
+
+  /*
+    Bytes owned by something else, like a vector, a mapped file or a part
+    of either. Parsers take a view so the parts of a container can be
+    parsed and corrupted where they are instead of being copied out first.
+
+    Indexing is unchecked like a vector, everything else throws
+    std::out_of_range when it would go past the end.
+  */
+  class ByteView
+  {
+  public:
+    ByteView() : m_data(nullptr), m_size(0) {};
+    ByteView(uint8_t* data, size_t size) : m_data(data), m_size(size) {};
+    ByteView(std::vector<uint8_t>& data) : m_data(data.empty() ? nullptr : &data[0]), m_size(data.size()) {};
+    ByteView(MappedFile& file) : m_data(file.data()), m_size(file.size()) {};
+
+    inline uint8_t* data() const
+    {
+      return m_data;
+    }
+
+    inline size_t size() const
+    {
+      return m_size;
+    }
+
+    inline bool empty() const
+    {
+      return m_size == 0;
+    }
+
+    inline uint8_t* begin() const
+    {
+      return m_data;
+    }
+
+    inline uint8_t* end() const
+    {
+      return m_data + m_size;
+    }
+
+    inline uint8_t& operator[](size_t index) const
+    {
+      return m_data[index];
+    }
+
+    inline uint8_t& at(size_t index) const
+    {
+      check(index, 1);
+      return m_data[index];
+    }
+
+    /*
+      @param offset - Start of the part
+      @param count - Length of the part, by default the rest of the view
+
+      @return a view of part of this one.
+    */
+    inline ByteView sub(size_t offset, size_t count = std::numeric_limits<size_t>::max()) const
+    {
+      if (count == std::numeric_limits<size_t>::max())
+      {
+        check(offset, 0);
+        count = m_size - offset;
+      }
+
+      check(offset, count);
+      return ByteView(m_data + offset, count);
+    }
+
+    template<typename T> inline T read(size_t offset = 0) const
+    {
+      static_assert(std::is_integral<T>::value, "Value must be an integral type.");
+      check(offset, sizeof(T));
+
+      T ret = 0;
+
+      for (uint32_t i = 0; i < sizeof(T); i++)
+      {
+        //  Cast it to T to allow proper shifting for 64 bit values
+        ret |= static_cast<T>(m_data[offset + i]) << (i * 8);
+      }
+
+      return ret;
+    }
+
+    template<typename T> inline T read_big(size_t offset = 0) const
+    {
+      static_assert(std::is_integral<T>::value, "Value must be an integral type.");
+      check(offset, sizeof(T));
+
+      T ret = 0;
+
+      for (uint32_t i = 0; i < sizeof(T); i++)
+      {
+        ret = static_cast<T>(ret << 8) | m_data[offset + i];
+      }
+
+      return ret;
+    }
+
+    /*
+      Reads a string with trailing whitespace removed.
+
+      @param offset - Start of the string
+      @param count - Length of the string, 0 reads up to the next null or the end
+    */
+    inline std::string string(size_t offset, size_t count = 0) const
+    {
+      if (count == 0)
+      {
+        check(offset, 0);
+
+        while (offset + count < m_size && m_data[offset + count] != '\0')
+        {
+          count++;
+        }
+      }
+
+      check(offset, count);
+
+      std::string ret(m_data + offset, m_data + offset + count);
+      ret.erase(ret.find_last_not_of(" \n\r\t") + 1);
+      return ret;
+    }
+
+  private:
+    inline void check(size_t offset, size_t count) const
+    {
+      if (offset > m_size || count > m_size - offset)
+      {
+        throw std::out_of_range("Read of " + std::to_string(count) + " bytes at " + std::to_string(offset) +
+                                " is past the end of " + std::to_string(m_size) + " bytes.");
+      }
+    }
+
+    uint8_t* m_data;
+    size_t m_size;
+  };
+
   inline void append_file(std::string filename, std::vector<uint8_t>& data, uint32_t count = 0, uint32_t offset = 0)
   {
     FILE *fp = fopen(filename.c_str(), "rb+");
@@ -122,38 +380,20 @@ namespace util
     }
   }
 
-  template <typename T> inline T read(std::vector<uint8_t>& data, uint32_t offset = 0)
+  template <typename T> inline T read(ByteView data, uint32_t offset = 0)
   {
-    static_assert(std::is_integral<T>::value, "Value must be an integral type.");
-    T ret = 0;
-
-    for (uint32_t i = 0; i < sizeof(T); i++)
-    {
-      //  Cast it to T to allow proper shifting for 64 bit values
-      ret |= static_cast<T>(data[i + offset]) << (i * 8);
-    }
-
-    return ret;
+    return data.read<T>(offset);
   }
 
-  template <typename T> inline T read_big(std::vector<uint8_t>& data, uint32_t offset = 0)
+  template <typename T> inline T read_big(ByteView data, uint32_t offset = 0)
   {
-    static_assert(std::is_integral<T>::value, "Value must be an integral type.");
-    T ret = 0;
-
-    for (int32_t i = sizeof(T)-1; i >= 0; i--)
-    {
-      //  Cast it to T to allow proper shifting for 64 bit values
-      ret |= static_cast<T>(data[i + offset]) << (((sizeof(T)-1) - i) * 8);
-    }
-
-    return ret;
+    return data.read_big<T>(offset);
   }
 
   template <typename T> inline T read_big(std::string file, uint32_t offset = 0)
   {
     static_assert(std::is_integral<T>::value, "Value must be an integral type.");
-    T ret = 0;
+    uint8_t bytes[sizeof(T)] = { 0 };
 
     FILE *fp = fopen(file.c_str(), "rb");
 
@@ -163,28 +403,15 @@ namespace util
     }
 
     fseek(fp, offset, SEEK_SET);
-    fread(&ret, sizeof(T), 1, fp);
+    fread(bytes, sizeof(T), 1, fp);
     fclose(fp);
 
-    return swap_endian<T>(ret);
+    return ByteView(bytes, sizeof(T)).read_big<T>();
   }
 
-  inline std::string read(std::vector<uint8_t>& data, uint32_t offset, size_t size = 0)
+  inline std::string read(ByteView data, uint32_t offset, size_t size = 0)
   {
-    uint32_t length = size;
-
-    //  If length is 0 then try to find the next null
-    if (size == 0)
-    {
-      while (data[offset + length] != '\0' && offset + length < data.size())
-      {
-        length++;
-      }
-    }
-
-    std::string ret(data.begin() + offset, data.begin() + offset + length);
-    ret.erase(ret.find_last_not_of(" \n\r\t") + 1);
-    return ret;
+    return data.string(offset, size);
   }
 
   inline std::string read(std::string& file, uint32_t offset, size_t size = 0)
@@ -264,6 +491,17 @@ namespace util
     return value;
   }
 
+  inline uint64_t to_int64(const std::string& str)
+  {
+    std::istringstream iss;
+    uint64_t value;
+
+    iss.str(str);
+    iss >> value;
+
+    return value;
+  }
+
   //  swap_endian taken from StackOverflow
   //  https://stackoverflow.com/questions/105252
   template <typename T> T swap_endian(T u)
@@ -296,6 +534,44 @@ namespace util
     return x >> (n % (sizeof(x)* 8)) | x << ((sizeof(x)* 8) - (n % (sizeof(x)* 8)));
   }
 
+  inline uint32_t popcount(uint64_t x)
+  {
+#if defined(__GNUC__)
+    return __builtin_popcountll(x);
+#else
+    x = x - ((x >> 1) & 0x5555555555555555ull);
+    x = (x & 0x3333333333333333ull) + ((x >> 2) & 0x3333333333333333ull);
+    x = (x + (x >> 4)) & 0x0F0F0F0F0F0F0F0Full;
+    return static_cast<uint32_t>((x * 0x0101010101010101ull) >> 56);
+#endif
+  }
+
+  /*
+    @param x - Bits to search
+    @param n - Index of the set bit to find, counting from the lowest bit. Must be less than popcount(x).
+
+    @return the position of the nth set bit.
+  */
+  inline uint32_t select(uint64_t x, uint32_t n)
+  {
+    uint32_t position = 0;
+
+    //  Halve the window each time, moving up when the bit isn't in the low half
+    for (uint32_t width = 32; width > 0; width /= 2)
+    {
+      uint32_t low = popcount(x & ((1ull << width) - 1));
+
+      if (n >= low)
+      {
+        n -= low;
+        x >>= width;
+        position += width;
+      }
+    }
+
+    return position;
+  }
+
   template<typename T, typename A> inline std::vector<T, A> subset(std::vector<T, A>& v, uint32_t start, uint32_t count)
   {
     return std::vector<T, A>(v.begin() + start, v.begin() + start + count);
@@ -303,7 +579,7 @@ namespace util
 
   template<typename T> inline void push_int(std::vector<uint8_t>& v, T val)
   {
-    for (int i = 0; i < sizeof(T); i++)
+    for (size_t i = 0; i < sizeof(T); i++)
     {
       v.push_back((val & (static_cast<T>(0xFF) << (i * 8))) >> (i * 8));
     }
@@ -30,6 +30,8 @@
   THE POSSIBILITY OF SUCH DAMAGE.
 */
 
+#include <algorithm>
+#include <chrono>
 #include <iostream>
 #include <memory>
 #include <string>
@@ -38,49 +40,15 @@
 #include <thread>
 
 #include "corrupt.h"
+#include "formats.h"
 #include "log.h"
+#include "rng.h"
+#include "rom_cache.h"
 
 
 #define MINIZ_HEADER_FILE_ONLY
 #include "miniz.c"
 
-/*
-  Takes a class type derived from Corruption and forms a template to execute the corruption
-
-  @type T - a type derived from Corruption
-  @param filename - filename or fully qualified path of the file to corrupt
-  @param args - Custom arguments that will be passed to the given class T
-*/
-template<typename T> void corrupt(std::string filename, std::vector<std::string> args)
-{
-  //  Give off appropriate errors if this template is compiled with a bad type.
-  static_assert(std::is_base_of<Corruption, T>::value, "function only takes a derived class of Corruption.");
-  //static_assert(std::is_default_constructible<T>::value, "class must have default constructor.");
-
-  //debug::cout << "Initializing." << std::endl;
-  std::unique_ptr<T> rom = std::make_unique<T>(filename, args);
-
-	try
-  {
-    //debug::cout << "Initializing." << std::endl;
-    //rom->initialize(filename, args);
-    //debug::cout << "Parsing." << std::endl;
-    //rom->parse(args);
-    //debug::cout << "Printing." << std::endl;
-    //rom->print_header();
-
-    rom->corrupt();
-
-    rom->save("output");
-
-    //rom->run();
-	}
-  catch (const std::exception& e)
-	{
-    std::cerr << "Exception: " << e.what() << std::endl;
-  }
-}
-
 /*
   Removes any unwanted temp files that were created.
 */
@@ -120,6 +88,13 @@ void usage(char *name)
     (--add, -a)   <x>: Adds a static value to the current byte.
     (--set, -t)   <x>: Sets the current byte to a static value.
     (--random)       : Will assign a randomly generated value to the current byte.
+    (--seed)      <x>: Seed for random corruptions, the same seed gives the same output.
+    (--variants)  <x>: Make x corruptions with different seeds from a single load of the file.
+                       Values can also be comma separated lists (--step 10,20) to make a
+                       corruption for every combination of them.
+    (--patch)     <x>: Save an ips, bps or ups patch against the original file instead of the corrupted file.
+    (--compression) <x>: fast or tight, how hard compressed GameCube and Wii files are packed again.
+                         Batches default to fast, single corruptions to tight.
 
   Note: For NES corruptions you will need to prepend a p/c or prg/chr to the argument.
     Ex: --step is either --prg-step | -ps or --chr-step | -cs
@@ -163,144 +138,106 @@ std::vector<std::string> split_args(std::string args)
   return ret;
 }
 
-void parse(std::vector<std::string> args)
-{
-  static std::vector<std::string> accepted_extentions = {
-    ".nes", ".smc", ".sfc", ".z64", ".n64", ".v64", ".gb", ".gbc", ".gba", ".nds", ".img", ".bin", ".md", ".smd", ".cdi", ".iso"
-  };
+void parse(std::vector<std::string> args);
 
-  std::string file(args[0]);
-  std::string extension = boost::filesystem::extension(file);
+/*
+  Corrupts every file in a zip archive that has the extension of a known
+  format, by extracting it and parsing it like any other file.
 
-  //std::cout << "File: " << file << std::endl;
-  //std::cout << "Ext : " << extension << std::endl;
+  @param file - The archive
+  @param args - Arguments of the run, without the filename
+*/
+void unzip(const std::string& file, std::vector<std::string>& args)
+{
+  std::vector<uint8_t> filedata;
+  mz_zip_archive zip_archive;
+  size_t uncomp_size;
 
-  args.erase(args.begin()); //  Remove the index that holds the filename
+  // Now try to open the archive.
+  memset(&zip_archive, 0, sizeof(zip_archive));
 
-  if (extension == ".zip")
+  mz_bool status = mz_zip_reader_init_file(&zip_archive, file.c_str(), 0);
+  if (!status)
   {
-    std::vector<uint8_t> filedata;
-    mz_zip_archive zip_archive;
-    size_t uncomp_size;
-
-    // Now try to open the archive.
-    memset(&zip_archive, 0, sizeof(zip_archive));
+    std::cerr << "mz_zip_reader_init_file() failed!" << std::endl;
+    return;
+  }
 
-    mz_bool status = mz_zip_reader_init_file(&zip_archive, file.c_str(), 0);
-    if (!status)
+  // Get and print information about each file in the archive.
+  for (int i = 0; i < (int)mz_zip_reader_get_num_files(&zip_archive); i++)
+  {
+    mz_zip_archive_file_stat file_stat;
+    if (!mz_zip_reader_file_stat(&zip_archive, i, &file_stat))
     {
-      std::cerr << "mz_zip_reader_init_file() failed!" << std::endl;
+      std::cerr << "mz_zip_reader_file_stat() failed!" << std::endl;
+      mz_zip_reader_end(&zip_archive);
       return;
     }
 
-    // Get and print information about each file in the archive.
-    for (int i = 0; i < (int)mz_zip_reader_get_num_files(&zip_archive); i++)
+    //std::cout << "Filename: \"" << file_stat.m_filename << "\"" << std::endl;
+
+    std::string ext = boost::filesystem::extension(file_stat.m_filename);
+
+    if (formats::Registry::shared().known_extension(ext))
     {
-      mz_zip_archive_file_stat file_stat;
-      if (!mz_zip_reader_file_stat(&zip_archive, i, &file_stat))
+      filedata.resize(file_stat.m_uncomp_size);
+
+      uint8_t *tmp = reinterpret_cast<uint8_t *>(mz_zip_reader_extract_file_to_heap(&zip_archive, file_stat.m_filename, &uncomp_size, 0));
+
+      for (int i = 0; i < file_stat.m_uncomp_size; i++)
       {
-        std::cerr << "mz_zip_reader_file_stat() failed!" << std::endl;
-        mz_zip_reader_end(&zip_archive);
-        return;
+        filedata[i] = static_cast<uint8_t>(tmp[i]);
       }
 
-      //std::cout << "Filename: \"" << file_stat.m_filename << "\"" << std::endl;
+      util::write_file(file_stat.m_filename, filedata);
 
-      std::string ext = boost::filesystem::extension(file_stat.m_filename);
+      std::vector<std::string> newargs(args);
+      newargs.insert(newargs.begin(), file_stat.m_filename);
+      parse(newargs);
 
-      if (std::find(accepted_extentions.begin(), accepted_extentions.end(), ext) != accepted_extentions.end())
-      {
-        filedata.resize(file_stat.m_uncomp_size);
-
-        uint8_t *tmp = reinterpret_cast<uint8_t *>(mz_zip_reader_extract_file_to_heap(&zip_archive, file_stat.m_filename, &uncomp_size, 0));
+      std::remove(file_stat.m_filename);
+    }
+    else
+    {
+      std::cout << "Extension " << ext << " not found. Skipping." << std::endl;
+    }
+  }
 
-        for (int i = 0; i < file_stat.m_uncomp_size; i++)
-        {
-          filedata[i] = static_cast<uint8_t>(tmp[i]);
-        }
+  mz_zip_reader_end(&zip_archive);
+}
 
-        util::write_file(file_stat.m_filename, filedata);
+static formats::Registrar zip({ "Zip", "", { ".zip" }, { { 0, formats::fourcc("PK\x03\x04") } }, unzip });
 
-        std::vector<std::string> newargs(args);
-        newargs.insert(newargs.begin(), file_stat.m_filename);
-        parse(newargs);
+void parse(std::vector<std::string> args)
+{
+  std::string file(args[0]);
 
-        std::remove(file_stat.m_filename);
-      }
-      else
-      {
-        std::cout << "Extension " << ext << " not found. Skipping." << std::endl;
-      }
-    }
+  args.erase(args.begin()); //  Remove the index that holds the filename
 
-    mz_zip_reader_end(&zip_archive);
-  }
-  //  --nintendo handles GameCube and Wii files. Eventually it will also handle NDS.
-  else if (std::find(args.begin(), args.end(), "--nintendo") != args.end())
-  {
-    args.erase(std::remove(args.begin(), args.end(), "--nintendo"), args.end());
+  //  Everything in this run derives its randomness from a single seed which
+  //  is printed so the run can be repeated with --seed
+  auto seed = std::find(args.begin(), args.end(), "--seed");
 
-    NintendoFile::start(file, args);
-  }
-  else if (std::find(args.begin(), args.end(), "--playstation") != args.end())
+  if (seed == args.end() || seed + 1 == args.end())
   {
-    args.erase(std::remove(args.begin(), args.end(), "--playstation"), args.end());
-    corrupt<PSXCorruption>(file, args);
+    args.erase(seed, args.end());
+    args.push_back("--seed");
+    args.push_back(std::to_string(rng::next_seed()));
+    seed = args.end() - 2;
   }
-  else if (std::find(args.begin(), args.end(), "--psp") != args.end())
-  {
-    args.erase(std::remove(args.begin(), args.end(), "--psp"), args.end());
-    corrupt<PSPCorruption>(file, args);
-  }
-  else if (std::find(args.begin(), args.end(), "--dreamcast") != args.end())
-  {
-    args.erase(std::remove(args.begin(), args.end(), "--dreamcast"), args.end());
-    corrupt<DreamcastCorruption>(file, args);
-  }
-  else if (std::find(args.begin(), args.end(), "--normal") != args.end())
-  {
-    args.erase(std::remove(args.begin(), args.end(), "--normal"), args.end());
-    corrupt<Corruption>(file, args);
-  }
-  else if (extension == ".nes")
-  {
-    corrupt<NESCorruption>(file, args);
-  }
-  else if (extension == ".smc" || extension == ".sfc")
-  {
-    corrupt<SNESCorruption>(file, args);
-  }
-  else if (extension == ".z64" || extension == ".v64" || extension == ".n64")
-  {
-    corrupt<N64Corruption>(file, args);
-  }
-  else if (extension == ".gbc" || extension == ".gb")
-  {
-    corrupt<GBCCorruption>(file, args);
-  }
-  else if (extension == ".gba")
-  {
-    corrupt<GBACorruption>(file, args);
-  }
-  else if (extension == ".nds")
-  {
-    corrupt<NDSCorruption>(file, args);
-  }
-  else if (extension == ".img" || (extension == ".bin" && boost::filesystem::file_size(file) > (16 * 0x100000)))
-  {
-    corrupt<PSXCorruption>(file, args);
-  }
-  else if (extension == ".bin" || extension == ".md" || extension == ".smd")
-  {
-    corrupt<GenesisCorruption>(file, args);
-  }
-  else if (extension == ".cdi")
+
+  std::cout << "Seed: " << *(seed + 1) << std::endl;
+
+  //  Backends register their formats in their own files, see formats.h
+  const formats::Format* format = formats::Registry::shared().detect(file, args);
+
+  if (format)
   {
-    corrupt<DreamcastCorruption>(file, args);
+    format->handler(file, args);
   }
   else
   {
-    corrupt<Corruption>(file, args);
+    formats::corrupt<Corruption>(file, args);
   }
 }
 
@@ -354,25 +291,34 @@ int main(int argc, char *argv[])
   if (std::find(args.begin(), args.end(), "--yay0") != args.end())
   {
     args.erase(std::remove(args.begin(), args.end(), "--yay0"), args.end());
-    auto data = yay0::decode(util::read_file(file));
-    util::write_file(file + ".yay0", data);
+    auto source = util::read_file(file);
+
+    try
+    {
+      auto data = yay0::decode(source);
+      util::write_file(file + ".yay0", data);
+    }
+    catch (const InvalidRomException& e)
+    {
+      std::cerr << "Error decoding '" << file << "': " << e.what() << std::endl;
+      exit(EXIT_FAILURE);
+    }
+
     exit(0);
   }
 
-  bool use_future = true;
-  bool use_threads = false;
+  bool use_pool = true;
 
   if (std::find(args.begin(), args.end(), "--single-threaded") != args.end())
   {
     args.erase(std::remove(args.begin(), args.end(), "--single-threaded"), args.end());
-    use_future = false;
+    use_pool = false;
   }
 
+  //  Kept for old batch scripts, lines always run on the thread pool now
   if (std::find(args.begin(), args.end(), "--std-threaded") != args.end())
   {
     args.erase(std::remove(args.begin(), args.end(), "--std-threaded"), args.end());
-    use_future = false;
-    use_threads = true;
   }
 
   //  If this is a batch execution then run each portion individually.
@@ -389,60 +335,38 @@ int main(int argc, char *argv[])
     }
 
     ifs.close();
-    
-    std::vector<std::thread> threads;
-
-    std::vector<std::future<void>> futures;
 
-    uint32_t max_threads = std::thread::hardware_concurrency();
-
-    if (max_threads == 0)
-    {
-      max_threads = 4;
-    }
+    //  Lines on the same file share one load of it
+    RomCache::shared().enable(true);
 
-    std::cout << "Maximum concurrent threads: " << max_threads << std::endl;
+    //  A batch writes many files, so compressed ones are packed for speed over size
+    NintendoFile::set_default_compression(yaz0::Level::Fast);
 
     auto start = std::chrono::high_resolution_clock::now();
     //  Pass each line of the batch file into the parser
 
-    if (use_future)
+    if (use_pool)
     {
-      for (uint32_t i = 0; i < batchargs.size();)
-      {
-        while (futures.size() < max_threads && i < batchargs.size())
-        {
-          futures.emplace_back(std::async(std::launch::async, parse, split_args(batchargs[i++])));
-        }
+      std::cout << "Maximum concurrent threads: " << ThreadPool::shared().size() << std::endl;
 
-        futures.erase(std::remove_if(futures.begin(), futures.end(),
-          [](std::future<void>& f)
-          {
-            return f.wait_for(std::chrono::milliseconds(0)) == std::future_status::ready;
-          }
-        ), futures.end());
-      }
+      //  Lines are queued as fast as the pool takes them, a slow line only holds up its own worker
+      std::vector<std::future<void>> futures;
 
-      for (auto& future : futures)
+      for (auto& line : batchargs)
       {
-        future.get();
+        futures.push_back(ThreadPool::shared().submit([&line] { parse(split_args(line)); }));
       }
-    }
-    else if (use_threads)
-    {
-      for (uint32_t i = 0; i < batchargs.size();)
+
+      for (uint32_t i = 0; i < futures.size(); i++)
       {
-        while (threads.size() < max_threads)
+        try
         {
-          threads.push_back(std::thread(parse, split_args(batchargs[i++])));
+          futures[i].get();
         }
-
-        for (auto& thread : threads)
+        catch (const std::exception& e)
         {
-          thread.join();
+          std::cerr << "Exception in batch line " << i + 1 << ": " << e.what() << std::endl;
         }
-
-        threads.clear();
       }
     }
     else
@@ -453,6 +377,8 @@ int main(int argc, char *argv[])
       }
     }
 
+    RomCache::shared().clear();
+
     auto end = std::chrono::high_resolution_clock::now();
     auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(end - start);
 
@@ -0,0 +1,160 @@
+#include "output.h"
+
+#include <boost/filesystem.hpp>
+
+#include <cerrno>
+
+#include "corruption_exceptions.h"
+
+#if defined(__linux__) || defined(__unix__) || defined(__APPLE__)
+#define OUTPUT_POSIX
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#if defined(__linux__)
+#include <linux/fs.h>
+#include <sys/ioctl.h>
+#endif
+
+namespace output
+{
+#if defined(__linux__)
+  /*
+    Clones or copies inside of the kernel.
+
+    @return false when neither is supported between the two files, before
+            anything was written.
+  */
+  static bool kernel_copy(const std::string& source, const std::string& target)
+  {
+    int in = open(source.c_str(), O_RDONLY);
+
+    if (in < 0)
+    {
+      throw FileOpenException(source);
+    }
+
+    struct stat info;
+
+    if (fstat(in, &info) != 0)
+    {
+      close(in);
+      throw FileOpenException(source);
+    }
+
+    int out = open(target.c_str(), O_WRONLY | O_CREAT | O_TRUNC, info.st_mode & 0777);
+
+    if (out < 0)
+    {
+      close(in);
+      throw FileOpenException(target);
+    }
+
+    bool copied = true;
+
+    //  Shares the blocks of the source, taking no time or space no matter the size
+    if (ioctl(out, FICLONE, in) != 0)
+    {
+      off_t left = info.st_size;
+
+      while (left > 0)
+      {
+        ssize_t count = copy_file_range(in, nullptr, out, nullptr, left, 0);
+
+        if (count <= 0)
+        {
+          if (count < 0 && errno == EINTR)
+          {
+            continue;
+          }
+
+          //  Unsupported here, or the files are on different filesystems on an older kernel
+          copied = false;
+          break;
+        }
+
+        left -= count;
+      }
+    }
+
+    close(out);
+    close(in);
+
+    return copied;
+  }
+#endif
+
+  void clone(const std::string& source, const std::string& target)
+  {
+    //  Writing over the source would truncate it before it is read
+    if (boost::filesystem::exists(target) && boost::filesystem::equivalent(source, target))
+    {
+      return;
+    }
+
+#if defined(__linux__)
+    if (kernel_copy(source, target))
+    {
+      return;
+    }
+#endif
+
+    boost::filesystem::remove(target);
+    boost::filesystem::copy_file(source, target);
+  }
+
+  File::File(const std::string& filename) : m_filename(filename), m_fd(-1)
+  {
+#ifdef OUTPUT_POSIX
+    m_fd = open(filename.c_str(), O_WRONLY);
+
+    if (m_fd < 0)
+    {
+      throw FileOpenException(filename);
+    }
+#else
+    m_file.open(filename, std::ios::in | std::ios::out | std::ios::binary);
+
+    if (!m_file.good())
+    {
+      throw FileOpenException(filename);
+    }
+#endif
+  }
+
+  File::~File()
+  {
+#ifdef OUTPUT_POSIX
+    close(m_fd);
+#endif
+  }
+
+  void File::write(uint64_t offset, const uint8_t* data, size_t size)
+  {
+#ifdef OUTPUT_POSIX
+    while (size > 0)
+    {
+      ssize_t count = pwrite(m_fd, data, size, offset);
+
+      if (count < 0)
+      {
+        if (errno == EINTR)
+        {
+          continue;
+        }
+
+        throw FileOpenException(m_filename);
+      }
+
+      data += count;
+      offset += count;
+      size -= count;
+    }
+#else
+    m_file.seekp(offset, std::ios::beg);
+    m_file.write(reinterpret_cast<const char*>(data), size);
+#endif
+  }
+}
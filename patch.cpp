@@ -0,0 +1,571 @@
+#include "patch.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <numeric>
+
+#include "corruption_exceptions.h"
+#include "output.h"
+#include "util.h"
+
+namespace patch
+{
+  //  Slice by 8 tables for the reflected CRC32 polynomial
+  struct CRCTable
+  {
+    uint32_t entries[8][0x100];
+  };
+
+  static constexpr CRCTable make_crc_table()
+  {
+    CRCTable table{};
+
+    for (uint32_t i = 0; i < 0x100; i++)
+    {
+      uint32_t crc = i;
+
+      for (uint32_t bit = 0; bit < 8; bit++)
+      {
+        crc = (crc >> 1) ^ (crc & 1 ? 0xEDB88320 : 0);
+      }
+
+      table.entries[0][i] = crc;
+    }
+
+    for (uint32_t i = 0; i < 0x100; i++)
+    {
+      for (uint32_t slice = 1; slice < 8; slice++)
+      {
+        uint32_t previous = table.entries[slice - 1][i];
+        table.entries[slice][i] = (previous >> 8) ^ table.entries[0][previous & 0xFF];
+      }
+    }
+
+    return table;
+  }
+
+  static constexpr CRCTable crc_table = make_crc_table();
+
+  uint32_t crc32(const uint8_t* data, size_t size, uint32_t crc)
+  {
+    const auto& t = crc_table.entries;
+    crc = ~crc;
+
+    for (; size >= 8; size -= 8, data += 8)
+    {
+      uint32_t low = crc ^ (data[0] | data[1] << 8 | data[2] << 16 | static_cast<uint32_t>(data[3]) << 24);
+
+      crc = t[7][low & 0xFF] ^ t[6][(low >> 8) & 0xFF] ^ t[5][(low >> 16) & 0xFF] ^ t[4][low >> 24] ^
+            t[3][data[4]] ^ t[2][data[5]] ^ t[1][data[6]] ^ t[0][data[7]];
+    }
+
+    for (; size > 0; size--, data++)
+    {
+      crc = (crc >> 8) ^ t[0][(crc ^ *data) & 0xFF];
+    }
+
+    return ~crc;
+  }
+
+  Format format(const std::string& name)
+  {
+    std::string lower(name);
+    std::transform(lower.begin(), lower.end(), lower.begin(), [](char c) { return static_cast<char>(std::tolower(c)); });
+
+    if (lower == "ips")
+    {
+      return Format::IPS;
+    }
+    else if (lower == "bps")
+    {
+      return Format::BPS;
+    }
+    else if (lower == "ups")
+    {
+      return Format::UPS;
+    }
+
+    throw InvalidArgumentException("Unknown patch format " + name);
+  }
+
+  std::string extension(Format format)
+  {
+    switch (format)
+    {
+    case Format::IPS: return ".ips";
+    case Format::BPS: return ".bps";
+    case Format::UPS: return ".ups";
+    default:          return "";
+    }
+  }
+
+  void Recorder::diff(uint64_t offset, const std::vector<uint8_t>& original, const std::vector<uint8_t>& modified)
+  {
+    diff(offset, original.data(), modified.data(), std::min(original.size(), modified.size()));
+  }
+
+  void Recorder::diff(uint64_t offset, const uint8_t* original, const uint8_t* modified, size_t size)
+  {
+    for (size_t i = 0; i < size; i++)
+    {
+      if (original[i] != modified[i])
+      {
+        record(offset + i, modified[i]);
+      }
+    }
+  }
+
+  void Recorder::append(Recorder&& other)
+  {
+    if (other.m_runs.empty())
+    {
+      return;
+    }
+
+    m_sorted = m_sorted && other.m_sorted &&
+      (m_runs.empty() || other.m_runs.front().offset > m_runs.back().offset + m_runs.back().bytes.size());
+
+    m_runs.insert(m_runs.end(), std::make_move_iterator(other.m_runs.begin()), std::make_move_iterator(other.m_runs.end()));
+    other.clear();
+  }
+
+  const std::vector<Run>& Recorder::runs() const
+  {
+    merge();
+
+    return m_runs;
+  }
+
+  void Recorder::merge() const
+  {
+    if (m_sorted)
+    {
+      return;
+    }
+
+    //  Stable so runs at the same offset stay in the order they were recorded
+    std::vector<size_t> order(m_runs.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::stable_sort(order.begin(), order.end(), [this](size_t a, size_t b)
+    {
+      return m_runs[a].offset < m_runs[b].offset;
+    });
+
+    bool overlap = false;
+
+    for (size_t i = 1; i < order.size() && !overlap; i++)
+    {
+      const Run& previous = m_runs[order[i - 1]];
+      overlap = m_runs[order[i]].offset < previous.offset + previous.bytes.size();
+    }
+
+    std::vector<Run> runs;
+
+    if (!overlap)
+    {
+      //  The usual case, runs only have to be put in order and joined
+      for (size_t index : order)
+      {
+        Run& run = m_runs[index];
+
+        if (!runs.empty() && runs.back().offset + runs.back().bytes.size() == run.offset)
+        {
+          runs.back().bytes.insert(runs.back().bytes.end(), run.bytes.begin(), run.bytes.end());
+        }
+        else
+        {
+          runs.push_back(std::move(run));
+        }
+      }
+    }
+    else
+    {
+      //  Offsets were written more than once, so the bytes are sorted one by
+      //  one in the order they were recorded and the last byte of each wins
+      std::vector<std::pair<uint64_t, uint8_t>> edits;
+
+      for (auto& run : m_runs)
+      {
+        for (size_t i = 0; i < run.bytes.size(); i++)
+        {
+          edits.emplace_back(run.offset + i, run.bytes[i]);
+        }
+      }
+
+      std::stable_sort(edits.begin(), edits.end(),
+        [](const std::pair<uint64_t, uint8_t>& a, const std::pair<uint64_t, uint8_t>& b)
+        {
+          return a.first < b.first;
+        }
+      );
+
+      for (size_t i = 0; i < edits.size(); i++)
+      {
+        if (i + 1 < edits.size() && edits[i + 1].first == edits[i].first)
+        {
+          continue;
+        }
+
+        if (runs.empty() || runs.back().offset + runs.back().bytes.size() != edits[i].first)
+        {
+          runs.push_back(Run{ edits[i].first, {} });
+        }
+
+        runs.back().bytes.push_back(edits[i].second);
+      }
+    }
+
+    m_runs = std::move(runs);
+    m_sorted = true;
+  }
+
+  namespace
+  {
+    class MemorySource
+    {
+    public:
+      MemorySource(const std::vector<uint8_t>& data) : m_data(data) {};
+
+      inline uint64_t size() const
+      {
+        return m_data.size();
+      }
+
+      inline void read(uint64_t offset, uint8_t* buffer, size_t count)
+      {
+        std::memcpy(buffer, m_data.data() + offset, count);
+      }
+
+    private:
+      const std::vector<uint8_t>& m_data;
+    };
+
+    class FileSource
+    {
+    public:
+      FileSource(const std::string& filename) : m_file(filename, std::ios::in | std::ios::binary)
+      {
+        if (!m_file.good())
+        {
+          throw FileOpenException(filename);
+        }
+
+        m_file.seekg(0, std::ios::end);
+        m_size = m_file.tellg();
+      }
+
+      inline uint64_t size() const
+      {
+        return m_size;
+      }
+
+      inline void read(uint64_t offset, uint8_t* buffer, size_t count)
+      {
+        m_file.seekg(offset, std::ios::beg);
+        m_file.read(reinterpret_cast<char*>(buffer), count);
+      }
+
+    private:
+      std::ifstream m_file;
+      uint64_t m_size;
+    };
+
+    //  Amount of the source read at a time when hashing
+    const size_t Block_Size = 0x100000;
+
+    //  An IPS record at this offset would read as the end of the patch
+    const uint32_t IPS_EOF = 0x454F46;
+
+    /*
+      Drops the bytes of the runs that are the same as the source, and any
+      past the end of it, splitting runs where needed.
+    */
+    template<typename S> std::vector<Run> changes(const std::vector<Run>& runs, S& source)
+    {
+      std::vector<Run> result;
+      std::vector<uint8_t> original;
+
+      for (auto& run : runs)
+      {
+        if (run.offset >= source.size())
+        {
+          break;
+        }
+
+        size_t count = std::min<uint64_t>(run.bytes.size(), source.size() - run.offset);
+        original.resize(count);
+        source.read(run.offset, original.data(), count);
+
+        for (size_t i = 0; i < count; i++)
+        {
+          if (original[i] == run.bytes[i])
+          {
+            continue;
+          }
+
+          if (result.empty() || result.back().offset + result.back().bytes.size() != run.offset + i)
+          {
+            result.push_back(Run{ run.offset + i, {} });
+          }
+
+          result.back().bytes.push_back(run.bytes[i]);
+        }
+      }
+
+      return result;
+    }
+
+    /*
+      Variable length integer used by BPS and UPS.
+    */
+    void push_number(std::vector<uint8_t>& out, uint64_t value)
+    {
+      for (;;)
+      {
+        uint8_t x = value & 0x7F;
+        value >>= 7;
+
+        if (value == 0)
+        {
+          out.push_back(0x80 | x);
+          break;
+        }
+
+        out.push_back(x);
+        value--;
+      }
+    }
+
+    /*
+      Hashes the source and the source with the changes applied in one pass.
+      When xor is given it receives source ^ target for every changed byte.
+    */
+    template<typename S> void hash(S& source, const std::vector<Run>& runs, uint32_t& source_crc, uint32_t& target_crc,
+                                   std::vector<std::vector<uint8_t>>* xor_bytes)
+    {
+      std::vector<uint8_t> block(Block_Size);
+      std::vector<uint8_t> original(Block_Size);
+      size_t run = 0;
+
+      source_crc = 0;
+      target_crc = 0;
+
+      if (xor_bytes)
+      {
+        xor_bytes->resize(runs.size());
+      }
+
+      for (uint64_t offset = 0; offset < source.size(); offset += Block_Size)
+      {
+        size_t count = std::min<uint64_t>(Block_Size, source.size() - offset);
+        source.read(offset, block.data(), count);
+        source_crc = crc32(block.data(), count, source_crc);
+
+        //  Copies of the source bytes are only needed for the xor
+        if (xor_bytes)
+        {
+          std::copy(block.begin(), block.begin() + count, original.begin());
+        }
+
+        for (; run < runs.size() && runs[run].offset < offset + count; run++)
+        {
+          for (size_t i = 0; i < runs[run].bytes.size(); i++)
+          {
+            uint64_t location = runs[run].offset + i;
+
+            //  The rest of the run is in the next block
+            if (location >= offset + count)
+            {
+              break;
+            }
+
+            if (location >= offset)
+            {
+              block[location - offset] = runs[run].bytes[i];
+
+              if (xor_bytes)
+              {
+                (*xor_bytes)[run].push_back(original[location - offset] ^ runs[run].bytes[i]);
+              }
+            }
+          }
+
+          //  Finish the run with the next block
+          if (runs[run].offset + runs[run].bytes.size() > offset + count)
+          {
+            break;
+          }
+        }
+
+        target_crc = crc32(block.data(), count, target_crc);
+      }
+    }
+
+    template<typename S> std::vector<uint8_t> make_ips(const std::vector<Run>& runs, S& source)
+    {
+      std::vector<uint8_t> out;
+      util::push(out, "PATCH");
+
+      for (auto& run : runs)
+      {
+        uint64_t offset = run.offset;
+        std::vector<uint8_t> bytes(run.bytes);
+
+        //  Start one byte earlier, the byte before a run is always unchanged
+        if (offset == IPS_EOF)
+        {
+          uint8_t before;
+          source.read(offset - 1, &before, 1);
+          bytes.insert(bytes.begin(), before);
+          offset--;
+        }
+
+        if (offset + bytes.size() > 0x1000000)
+        {
+          throw InvalidArgumentException("IPS patches can't change data past 16 MB, use BPS or UPS instead");
+        }
+
+        for (size_t written = 0; written < bytes.size();)
+        {
+          size_t count = std::min<size_t>(0xFFFF, bytes.size() - written);
+
+          //  Don't let the next record start on the end marker
+          if (offset + written + count == IPS_EOF && written + count < bytes.size())
+          {
+            count--;
+          }
+
+          uint32_t location = static_cast<uint32_t>(offset + written);
+          out.push_back((location >> 16) & 0xFF);
+          out.push_back((location >> 8) & 0xFF);
+          out.push_back(location & 0xFF);
+          util::push_int_big<uint16_t>(out, static_cast<uint16_t>(count));
+          out.insert(out.end(), bytes.begin() + written, bytes.begin() + written + count);
+
+          written += count;
+        }
+      }
+
+      util::push(out, "EOF");
+
+      return out;
+    }
+
+    template<typename S> std::vector<uint8_t> make_bps(const std::vector<Run>& runs, S& source)
+    {
+      enum Action
+      {
+        SourceRead = 0,
+        TargetRead = 1
+      };
+
+      uint32_t source_crc;
+      uint32_t target_crc;
+      hash(source, runs, source_crc, target_crc, nullptr);
+
+      std::vector<uint8_t> out;
+      util::push(out, "BPS1");
+      push_number(out, source.size());
+      push_number(out, source.size());
+      push_number(out, 0);  //  No metadata
+
+      uint64_t position = 0;
+
+      for (auto& run : runs)
+      {
+        if (run.offset > position)
+        {
+          push_number(out, ((run.offset - position - 1) << 2) | SourceRead);
+        }
+
+        push_number(out, ((run.bytes.size() - 1) << 2) | TargetRead);
+        out.insert(out.end(), run.bytes.begin(), run.bytes.end());
+
+        position = run.offset + run.bytes.size();
+      }
+
+      if (position < source.size())
+      {
+        push_number(out, ((source.size() - position - 1) << 2) | SourceRead);
+      }
+
+      util::push_int<uint32_t>(out, source_crc);
+      util::push_int<uint32_t>(out, target_crc);
+      util::push_int<uint32_t>(out, crc32(out.data(), out.size()));
+
+      return out;
+    }
+
+    template<typename S> std::vector<uint8_t> make_ups(const std::vector<Run>& runs, S& source)
+    {
+      uint32_t source_crc;
+      uint32_t target_crc;
+      std::vector<std::vector<uint8_t>> xor_bytes;
+      hash(source, runs, source_crc, target_crc, &xor_bytes);
+
+      std::vector<uint8_t> out;
+      util::push(out, "UPS1");
+      push_number(out, source.size());
+      push_number(out, source.size());
+
+      uint64_t position = 0;
+
+      for (size_t i = 0; i < runs.size(); i++)
+      {
+        //  Every byte of a change differs from the source so none of them xor to the terminator
+        push_number(out, runs[i].offset - position);
+        out.insert(out.end(), xor_bytes[i].begin(), xor_bytes[i].end());
+        out.push_back(0);
+
+        position = runs[i].offset + runs[i].bytes.size() + 1;
+      }
+
+      util::push_int<uint32_t>(out, source_crc);
+      util::push_int<uint32_t>(out, target_crc);
+      util::push_int<uint32_t>(out, crc32(out.data(), out.size()));
+
+      return out;
+    }
+
+    template<typename S> void write(const std::string& filename, Format format, const Recorder& edits, S& source)
+    {
+      std::vector<Run> runs = changes(edits.runs(), source);
+      std::vector<uint8_t> out;
+
+      switch (format)
+      {
+      case Format::IPS: out = make_ips(runs, source); break;
+      case Format::BPS: out = make_bps(runs, source); break;
+      case Format::UPS: out = make_ups(runs, source); break;
+      default:          return;
+      }
+
+      util::write_file(filename, out);
+    }
+  }
+
+  void write(const std::string& filename, Format format, const Recorder& edits, const std::vector<uint8_t>& source)
+  {
+    MemorySource memory(source);
+    write<MemorySource>(filename, format, edits, memory);
+  }
+
+  void write(const std::string& filename, Format format, const Recorder& edits, const std::string& source)
+  {
+    FileSource file(source);
+    write<FileSource>(filename, format, edits, file);
+  }
+
+  void apply(const std::string& filename, const Recorder& edits)
+  {
+    output::File file(filename);
+
+    for (auto& run : edits.runs())
+    {
+      file.write(run.offset, run.bytes.data(), run.bytes.size());
+    }
+  }
+}
@@ -0,0 +1,500 @@
+#include "simd.h"
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+#define SIMD_X86
+#include <immintrin.h>
+#endif
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#define SIMD_TARGET(isa)
+#else
+#define SIMD_TARGET(isa) __attribute__((target(isa)))
+#endif
+
+namespace simd
+{
+  /*
+    Every supported operation can be written as
+
+      x = rol(x + add, rotate)
+      x = ((x & keep) | set) ^ flip
+
+    with the other parameters left as identity, which lets a single kernel
+    handle all of them without branching on the operation.
+  */
+  struct Transform
+  {
+    uint8_t add;
+    uint8_t rotate;
+    uint8_t keep;
+    uint8_t set;
+    uint8_t flip;
+  };
+
+  static bool make_transform(CorruptionType type, uint32_t value, Transform& t)
+  {
+    t.add = 0;
+    t.rotate = 0;
+    t.keep = 0xFF;
+    t.set = 0;
+    t.flip = 0;
+
+    switch (type)
+    {
+    case CorruptionType::Add:               t.add = value; break;
+    case CorruptionType::Set:               t.keep = 0; t.set = value; break;
+    case CorruptionType::RotateLeft:        t.rotate = value % 8; break;
+    case CorruptionType::RotateRight:       t.rotate = (8 - value % 8) % 8; break;
+    case CorruptionType::LogicalAnd:        t.keep = value; break;
+    case CorruptionType::LogicalOr:         t.set = value; break;
+    case CorruptionType::LogicalXor:        t.flip = value; break;
+    case CorruptionType::LogicalComplement: t.flip = 0xFF; break;
+    default:                                return false;
+    }
+
+    return true;
+  }
+
+  static inline uint8_t apply(const Transform& t, uint8_t x)
+  {
+    x += t.add;
+    x = static_cast<uint8_t>(x << t.rotate | x >> ((8 - t.rotate) & 7));
+    return ((x & t.keep) | t.set) ^ t.flip;
+  }
+
+  static inline bool allowed(const Protection& protection, uint8_t byte)
+  {
+    return !protection.values || ((protection.values[byte >> 6] >> (byte & 63)) & 1);
+  }
+
+  static inline bool protected_location(const Protection& protection, uint64_t location)
+  {
+    if (!protection.bits)
+    {
+      return false;
+    }
+
+    if (location < protection.begin || location >= protection.end)
+    {
+      return true;
+    }
+
+    uint64_t index = location - protection.begin;
+    return (protection.bits[index >> 6] >> (index & 63)) & 1;
+  }
+
+  /*
+    @return protection bits for the 64 offsets starting at location.
+  */
+  static inline uint64_t protected_bits(const Protection& protection, uint64_t location)
+  {
+    if (!protection.bits)
+    {
+      return 0;
+    }
+
+    if (location >= protection.begin && location + 64 <= protection.end)
+    {
+      uint64_t index = location - protection.begin;
+      uint64_t shift = index & 63;
+      uint64_t bits = protection.bits[index >> 6] >> shift;
+
+      if (shift)
+      {
+        bits |= protection.bits[(index >> 6) + 1] << (64 - shift);
+      }
+
+      return bits;
+    }
+
+    //  Block runs over the edge of the protected range
+    uint64_t bits = 0;
+
+    for (uint32_t i = 0; i < 64; i++)
+    {
+      bits |= static_cast<uint64_t>(protected_location(protection, location + i)) << i;
+    }
+
+    return bits;
+  }
+
+  /*
+    Scalar version of the kernels for the bytes that don't fill a vector.
+  */
+  static uint64_t transform_scalar(const Transform& t, uint8_t* data, uint64_t start, uint64_t end, uint32_t step, const Protection& protection)
+  {
+    uint64_t corruptions = 0;
+
+    for (uint64_t i = start; i < end; i += step)
+    {
+      uint8_t byte = apply(t, data[i]);
+
+      if (allowed(protection, byte) && !protected_location(protection, i))
+      {
+        data[i] = byte;
+        corruptions++;
+      }
+    }
+
+    return corruptions;
+  }
+
+  static inline uint32_t popcount(uint32_t x)
+  {
+#if defined(_MSC_VER)
+    return __popcnt(x);
+#else
+    return __builtin_popcount(x);
+#endif
+  }
+
+#ifdef SIMD_X86
+  //  Every bit of the index expanded into a byte of 0x00 or 0xFF
+  struct ExpandTable
+  {
+    uint64_t bytes[0x100];
+  };
+
+  static constexpr ExpandTable make_expand_table()
+  {
+    ExpandTable table{};
+
+    for (uint32_t i = 0; i < 0x100; i++)
+    {
+      for (uint32_t bit = 0; bit < 8; bit++)
+      {
+        if (i & (1 << bit))
+        {
+          table.bytes[i] |= 0xFFull << (bit * 8);
+        }
+      }
+    }
+
+    return table;
+  }
+
+  static constexpr ExpandTable expand = make_expand_table();
+
+  //  Byte mask of the positions inside of a vector that are a multiple of step
+  static inline uint32_t stride_pattern(uint32_t step)
+  {
+    return step == 1 ? 0xFFFFFFFF : step == 2 ? 0x00FF00FF : 0x000000FF;
+  }
+
+  SIMD_TARGET("sse2")
+  static uint64_t transform_sse2(const Transform& t, uint8_t* data, uint64_t start, uint64_t end, uint32_t step, const Protection& protection)
+  {
+    uint64_t corruptions = 0;
+    uint64_t i = start;
+
+    const __m128i add = _mm_set1_epi8(static_cast<char>(t.add));
+    const __m128i keep = _mm_set1_epi8(static_cast<char>(t.keep));
+    const __m128i set = _mm_set1_epi8(static_cast<char>(t.set));
+    const __m128i flip = _mm_set1_epi8(static_cast<char>(t.flip));
+    const __m128i left = _mm_cvtsi32_si128(t.rotate);
+    const __m128i right = _mm_cvtsi32_si128(8 - t.rotate);
+    const __m128i left_mask = _mm_set1_epi8(static_cast<char>(0xFF << t.rotate));
+    const __m128i right_mask = _mm_set1_epi8(static_cast<char>(0xFF >> (8 - t.rotate)));
+    const __m128i stride = _mm_set1_epi32(static_cast<int>(stride_pattern(step)));
+
+    for (; i + 16 <= end; i += 16)
+    {
+      __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i));
+
+      __m128i y = _mm_add_epi8(x, add);
+      y = _mm_or_si128(_mm_and_si128(_mm_sll_epi16(y, left), left_mask),
+                       _mm_and_si128(_mm_srl_epi16(y, right), right_mask));
+      y = _mm_xor_si128(_mm_or_si128(_mm_and_si128(y, keep), set), flip);
+
+      __m128i mask = stride;
+
+      if (protection.bits)
+      {
+        uint64_t bits = ~protected_bits(protection, i);
+        mask = _mm_and_si128(mask, _mm_set_epi64x(static_cast<long long>(expand.bytes[(bits >> 8) & 0xFF]),
+                                                  static_cast<long long>(expand.bytes[bits & 0xFF])));
+      }
+
+      _mm_storeu_si128(reinterpret_cast<__m128i*>(data + i), _mm_or_si128(_mm_and_si128(mask, y), _mm_andnot_si128(mask, x)));
+
+      corruptions += popcount(_mm_movemask_epi8(mask));
+    }
+
+    return corruptions + transform_scalar(t, data, i, end, step, protection);
+  }
+
+  SIMD_TARGET("avx2")
+  static uint64_t transform_avx2(const Transform& t, uint8_t* data, uint64_t start, uint64_t end, uint32_t step, const Protection& protection)
+  {
+    uint64_t corruptions = 0;
+    uint64_t i = start;
+
+    const __m256i add = _mm256_set1_epi8(static_cast<char>(t.add));
+    const __m256i keep = _mm256_set1_epi8(static_cast<char>(t.keep));
+    const __m256i set = _mm256_set1_epi8(static_cast<char>(t.set));
+    const __m256i flip = _mm256_set1_epi8(static_cast<char>(t.flip));
+    const __m128i left = _mm_cvtsi32_si128(t.rotate);
+    const __m128i right = _mm_cvtsi32_si128(8 - t.rotate);
+    const __m256i left_mask = _mm256_set1_epi8(static_cast<char>(0xFF << t.rotate));
+    const __m256i right_mask = _mm256_set1_epi8(static_cast<char>(0xFF >> (8 - t.rotate)));
+    const __m256i stride = _mm256_set1_epi32(static_cast<int>(stride_pattern(step)));
+
+    //  Allowed values are looked up with a byte shuffle. Row (value >> 3) of the
+    //  value bitmap holds the bits for 8 values, rows 0-15 and 16-31 are two tables.
+    __m256i rows_low = _mm256_setzero_si256();
+    __m256i rows_high = _mm256_setzero_si256();
+    const __m256i bit_select = _mm256_setr_epi8(1, 2, 4, 8, 16, 32, 64, -128, 1, 2, 4, 8, 16, 32, 64, -128,
+                                                1, 2, 4, 8, 16, 32, 64, -128, 1, 2, 4, 8, 16, 32, 64, -128);
+
+    if (protection.values)
+    {
+      __m128i low = _mm_loadu_si128(reinterpret_cast<const __m128i*>(protection.values));
+      __m128i high = _mm_loadu_si128(reinterpret_cast<const __m128i*>(protection.values + 2));
+      rows_low = _mm256_broadcastsi128_si256(low);
+      rows_high = _mm256_broadcastsi128_si256(high);
+    }
+
+    for (; i + 32 <= end; i += 32)
+    {
+      __m256i x = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + i));
+
+      __m256i y = _mm256_add_epi8(x, add);
+      y = _mm256_or_si256(_mm256_and_si256(_mm256_sll_epi16(y, left), left_mask),
+                          _mm256_and_si256(_mm256_srl_epi16(y, right), right_mask));
+      y = _mm256_xor_si256(_mm256_or_si256(_mm256_and_si256(y, keep), set), flip);
+
+      __m256i mask = stride;
+
+      if (protection.bits)
+      {
+        uint64_t bits = ~protected_bits(protection, i);
+        mask = _mm256_and_si256(mask, _mm256_set_epi64x(static_cast<long long>(expand.bytes[(bits >> 24) & 0xFF]),
+                                                        static_cast<long long>(expand.bytes[(bits >> 16) & 0xFF]),
+                                                        static_cast<long long>(expand.bytes[(bits >> 8) & 0xFF]),
+                                                        static_cast<long long>(expand.bytes[bits & 0xFF])));
+      }
+
+      if (protection.values)
+      {
+        __m256i index = _mm256_and_si256(_mm256_srli_epi16(y, 3), _mm256_set1_epi8(0x0F));
+        __m256i row = _mm256_blendv_epi8(_mm256_shuffle_epi8(rows_low, index), _mm256_shuffle_epi8(rows_high, index), y);
+        __m256i bit = _mm256_shuffle_epi8(bit_select, _mm256_and_si256(y, _mm256_set1_epi8(0x07)));
+
+        mask = _mm256_and_si256(mask, _mm256_cmpeq_epi8(_mm256_and_si256(row, bit), bit));
+      }
+
+      _mm256_storeu_si256(reinterpret_cast<__m256i*>(data + i), _mm256_blendv_epi8(x, y, mask));
+
+      corruptions += popcount(_mm256_movemask_epi8(mask));
+    }
+
+    return corruptions + transform_scalar(t, data, i, end, step, protection);
+  }
+
+  static Level detect()
+  {
+#if defined(_MSC_VER)
+    int info[4];
+    __cpuid(info, 0);
+    int ids = info[0];
+
+    __cpuid(info, 1);
+    bool sse2 = (info[3] & (1 << 26)) != 0;
+    bool avx = (info[2] & (1 << 28)) != 0 && (info[2] & (1 << 27)) != 0 && (_xgetbv(0) & 0x6) == 0x6;
+
+    bool avx2 = false;
+
+    if (ids >= 7)
+    {
+      __cpuidex(info, 7, 0);
+      avx2 = avx && (info[1] & (1 << 5)) != 0;
+    }
+#else
+    __builtin_cpu_init();
+    bool sse2 = __builtin_cpu_supports("sse2");
+    bool avx2 = __builtin_cpu_supports("avx2");
+#endif
+
+    return avx2 ? AVX2 : sse2 ? SSE2 : Scalar;
+  }
+#else
+  static Level detect()
+  {
+    return Scalar;
+  }
+#endif
+
+  Level level()
+  {
+    static const Level detected = detect();
+    return detected;
+  }
+
+  bool transform(CorruptionType type, uint32_t value, uint8_t* data, uint64_t start, uint64_t end,
+                 uint32_t step, const Protection& protection, uint64_t& corruptions)
+  {
+    Transform t;
+
+    if ((step != 1 && step != 2 && step != 4) || !make_transform(type, value, t))
+    {
+      return false;
+    }
+
+    Level isa = level();
+
+    if (isa == Scalar)
+    {
+      return false;
+    }
+
+    if (start >= end)
+    {
+      corruptions = 0;
+      return true;
+    }
+
+    Protection checked = protection;
+
+    //  Set writes the same byte everywhere so its value only has to be checked once
+    if (type == CorruptionType::Set && protection.values)
+    {
+      if (!allowed(protection, t.set))
+      {
+        corruptions = 0;
+        return true;
+      }
+
+      checked.values = nullptr;
+    }
+
+#ifdef SIMD_X86
+    if (isa == AVX2)
+    {
+      corruptions = transform_avx2(t, data, start, end, step, checked);
+      return true;
+    }
+
+    //  Value lookups need a byte shuffle which SSE2 doesn't have
+    if (checked.values)
+    {
+      return false;
+    }
+
+    corruptions = transform_sse2(t, data, start, end, step, checked);
+    return true;
+#else
+    return false;
+#endif
+  }
+
+  //  Multiplies by x in the field of the CD ECC
+  static inline uint8_t gf_double(uint8_t x)
+  {
+    return static_cast<uint8_t>((x << 1) ^ ((x & 0x80) ? 0x1D : 0));
+  }
+
+  static void parity_scalar(const uint8_t* rows, uint32_t count, uint32_t width, uint32_t first, uint8_t* a, uint8_t* b)
+  {
+    for (uint32_t i = first; i < width; i++)
+    {
+      uint8_t x = a[i];
+      uint8_t y = b[i];
+
+      for (uint32_t row = 0; row < count; row++)
+      {
+        uint8_t value = rows[row * width + i];
+
+        x = gf_double(x ^ value);
+        y ^= value;
+      }
+
+      a[i] = x;
+      b[i] = y;
+    }
+  }
+
+#ifdef SIMD_X86
+  /*
+    @return the first lane that was left for a narrower kernel.
+  */
+  SIMD_TARGET("sse2")
+  static uint32_t parity_sse2(const uint8_t* rows, uint32_t count, uint32_t width, uint32_t first, uint8_t* a, uint8_t* b)
+  {
+    const __m128i poly = _mm_set1_epi8(0x1D);
+    const __m128i zero = _mm_setzero_si128();
+    uint32_t i = first;
+
+    for (; i + 16 <= width; i += 16)
+    {
+      __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(a + i));
+      __m128i y = _mm_loadu_si128(reinterpret_cast<const __m128i*>(b + i));
+
+      for (uint32_t row = 0; row < count; row++)
+      {
+        __m128i value = _mm_loadu_si128(reinterpret_cast<const __m128i*>(rows + row * width + i));
+
+        x = _mm_xor_si128(x, value);
+        y = _mm_xor_si128(y, value);
+
+        //  Doubling carries out of the top bit, which is folded back in with the polynomial
+        x = _mm_xor_si128(_mm_add_epi8(x, x), _mm_and_si128(_mm_cmplt_epi8(x, zero), poly));
+      }
+
+      _mm_storeu_si128(reinterpret_cast<__m128i*>(a + i), x);
+      _mm_storeu_si128(reinterpret_cast<__m128i*>(b + i), y);
+    }
+
+    return i;
+  }
+
+  SIMD_TARGET("avx2")
+  static uint32_t parity_avx2(const uint8_t* rows, uint32_t count, uint32_t width, uint32_t first, uint8_t* a, uint8_t* b)
+  {
+    const __m256i poly = _mm256_set1_epi8(0x1D);
+    const __m256i zero = _mm256_setzero_si256();
+    uint32_t i = first;
+
+    for (; i + 32 <= width; i += 32)
+    {
+      __m256i x = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(a + i));
+      __m256i y = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(b + i));
+
+      for (uint32_t row = 0; row < count; row++)
+      {
+        __m256i value = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(rows + row * width + i));
+
+        x = _mm256_xor_si256(x, value);
+        y = _mm256_xor_si256(y, value);
+        x = _mm256_xor_si256(_mm256_add_epi8(x, x), _mm256_and_si256(_mm256_cmpgt_epi8(zero, x), poly));
+      }
+
+      _mm256_storeu_si256(reinterpret_cast<__m256i*>(a + i), x);
+      _mm256_storeu_si256(reinterpret_cast<__m256i*>(b + i), y);
+    }
+
+    return i;
+  }
+#endif
+
+  void parity(const uint8_t* rows, uint32_t count, uint32_t width, uint8_t* a, uint8_t* b)
+  {
+    uint32_t first = 0;
+
+#ifdef SIMD_X86
+    Level isa = level();
+
+    if (isa == AVX2)
+    {
+      first = parity_avx2(rows, count, width, first, a, b);
+    }
+
+    if (isa != Scalar)
+    {
+      first = parity_sse2(rows, count, width, first, a, b);
+    }
+#endif
+
+    parity_scalar(rows, count, width, first, a, b);
+  }
+}